@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "Config.h"
+#include "Stepper.h"
+#include "Storage.h"
+#include "WS2812.h"
+
+// The configuration is kept in flash twice, one copy per sector. A save always replaces the older copy,
+// so a power loss while writing leaves the newer one intact, and on load the valid copy with the higher
+// sequence number wins. Each copy is a header followed by as many bytes of struct clockConfig as the
+// firmware that wrote it knew about.
+
+#define CONFIG_MAGIC 0x31474643 // "CFG1"
+
+struct configHeader
+{
+    uint32_t magic;
+
+    /// @brief CONFIG_VERSION of the firmware that wrote the copy.
+    uint16_t version;
+
+    /// @brief Number of bytes of struct clockConfig that follow the header.
+    uint16_t length;
+
+    /// @brief Counts up with every save. 0xffffffff in an erased sector.
+    uint32_t sequence;
+
+    /// @brief CRC-32 of the version, the length, the sequence and the configuration.
+    /// Tells a copy that got cut short by a power loss from a complete one.
+    uint32_t crc;
+};
+
+/// @brief The configuration in use, the defaults until configLoad finds a stored copy.
+struct clockConfig config = {
+    false,                 // enableHourlyAnimation
+    0,                     // animationStartHour
+    23,                    // animationEndHour
+    255,                   // brightness
+    WS2812_RANDOM_PATTERN, // pattern
+    false,                 // invertHour
+    false,                 // invertMinute
+    0,                     // rtcTrimPpb
+    0,                     // rtcTrimMinutes
+    STEPPER_HOLD_MODE,     // holdHour
+    STEPPER_HOLD_MODE,     // holdMinute
+    STEPPER_HOLD_DUTY,     // holdDutyHour
+    STEPPER_HOLD_DUTY,     // holdDutyMinute
+    0,                     // timeZone
+};
+
+/// @brief The configuration in the newest copy, saving it again is skipped.
+static struct clockConfig storedConfig;
+
+/// @brief Sector of the newest copy (0 or 1), -1 when there is none yet.
+static int32_t storedSlot = -1;
+static uint32_t storedSequence = 0;
+
+static uint32_t crc32(uint32_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *bytes = data;
+
+    crc = ~crc;
+    while (length-- > 0)
+    {
+        crc ^= *bytes++;
+        for (uint32_t bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+    }
+
+    return ~crc;
+}
+
+static uint32_t check(const struct configHeader *header, const void *data)
+{
+    uint32_t crc = crc32(0, &header->version, sizeof(header->version));
+    crc = crc32(crc, &header->length, sizeof(header->length));
+    crc = crc32(crc, &header->sequence, sizeof(header->sequence));
+    return crc32(crc, data, header->length);
+}
+
+static uint32_t slotOffset(uint32_t slot)
+{
+    return STORAGE_CONFIG_OFFSET + slot * FLASH_SECTOR_SIZE;
+}
+
+/// @brief Returns the copy in the given sector or NULL when it isn't a complete copy this firmware can use.
+static const struct configHeader *readCopy(uint32_t slot)
+{
+    const struct configHeader *header = storageRead(slotOffset(slot));
+
+    if (header->magic != CONFIG_MAGIC || header->version != CONFIG_VERSION ||
+        header->length > FLASH_SECTOR_SIZE - sizeof(struct configHeader))
+        return NULL;
+
+    if (header->crc != check(header, header + 1))
+        return NULL;
+
+    return header;
+}
+
+/// @brief Loads the newest stored configuration over the defaults. Reads the flash only, safe to call before anything is set up.
+/// @return false when there is no stored configuration yet, the defaults stay in use then.
+bool configLoad()
+{
+    const struct configHeader *newest = NULL;
+
+    for (uint32_t slot = 0; slot < 2; slot++)
+    {
+        const struct configHeader *copy = readCopy(slot);
+        if (copy != NULL && (newest == NULL || (int32_t)(copy->sequence - newest->sequence) > 0))
+        {
+            newest = copy;
+            storedSlot = slot;
+        }
+    }
+
+    if (newest == NULL)
+        return false;
+
+    // Fields an older firmware didn't know about keep their defaults, fields of a newer one get dropped
+    memcpy(&config, newest + 1, MIN(newest->length, sizeof(config)));
+
+    storedConfig = config;
+    storedSequence = newest->sequence;
+    return true;
+}
+
+/// @brief Stores the configuration in the sector of the older copy. Does nothing when it hasn't changed.
+/// Erasing the sector holds off the interrupts for ~50ms, only call it from thread mode on core 0.
+void configSave()
+{
+    if (storedSlot >= 0 && memcmp(&config, &storedConfig, sizeof(config)) == 0)
+        return;
+
+    struct
+    {
+        struct configHeader header;
+        struct clockConfig config;
+    } copy;
+
+    uint32_t slot = storedSlot == 0 ? 1 : 0;
+
+    copy.header.magic = CONFIG_MAGIC;
+    copy.header.version = CONFIG_VERSION;
+    copy.header.length = sizeof(copy.config);
+    copy.header.sequence = storedSequence + 1;
+    copy.config = config;
+    copy.header.crc = check(&copy.header, &copy.config);
+
+    storageErase(slotOffset(slot), FLASH_SECTOR_SIZE);
+    storageProgram(slotOffset(slot), &copy, sizeof(copy.header) + sizeof(copy.config));
+
+    storedConfig = config;
+    storedSlot = slot;
+    storedSequence = copy.header.sequence;
+}
@@ -0,0 +1,57 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "pico/types.h"
+
+/// @brief Layout version of the stored configuration. Only needs to change when a field changes its meaning,
+/// new fields get added at the end of struct clockConfig and keep their defaults when an older copy is loaded.
+#define CONFIG_VERSION 1
+
+/// @brief Everything the setup asks for except the time, kept in flash so it survives a power loss.
+struct clockConfig
+{
+    /// @brief Indicates whether the hourly animations are enabled
+    bool enableHourlyAnimation;
+
+    /// @brief The hour that the animations are supposed to start at
+    /// 0 to 23 inclusive
+    uint8_t animationStartHour;
+
+    /// @brief The hour that the animations are supposed to end at
+    /// 0 to 23 inclusive
+    uint8_t animationEndHour;
+
+    /// @brief Brightness all patterns get scaled by (0 to 255).
+    uint8_t brightness;
+
+    /// @brief Pattern of the hourly animation, index into the pattern table or WS2812_RANDOM_PATTERN.
+    uint8_t pattern;
+
+    /// @brief Run the step sequence of a motor the other way round, for motors that are wired the other way round.
+    bool invertHour;
+    bool invertMinute;
+
+    /// @brief What happens to the coils of a motor once it has settled after a step (enum stepperHoldMode)
+    /// and their duty in percent of the running duty with STEPPER_HOLD_REDUCED.
+    uint8_t holdHour;
+    uint8_t holdMinute;
+    uint8_t holdDutyHour;
+    uint8_t holdDutyMinute;
+
+    /// @brief How much the rtc gets moved ahead in parts per billion of the time that passes, negative moves it back.
+    /// Not a setting, learned from how far the rtc was off at each SYNC TIME.
+    int32_t rtcTrimPpb;
+
+    /// @brief How many minutes between syncs the trim is based on. A new measurement counts for as many minutes as it spans.
+    uint32_t rtcTrimMinutes;
+
+    /// @brief Index into timeZones of the zone the hands show the time of, 0 is UTC.
+    uint8_t timeZone;
+};
+
+extern struct clockConfig config;
+
+bool configLoad();
+void configSave();
+
+#endif
@@ -0,0 +1,689 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/rtc.h"
+#include "hardware/timer.h"
+#include "pico/stdlib.h"
+
+#include "Config.h"
+#include "Console.h"
+#include "DateTimeParser.h"
+#include "EventLog.h"
+#include "HandJournal.h"
+#include "Power.h"
+#include "RTC.h"
+#include "Seek.h"
+#include "Stepper.h"
+#include "TimeZone.h"
+#include "Trace.h"
+#include "WarmStart.h"
+#include "WorkQueue.h"
+#include "WS2812.h"
+
+// Line based command protocol on the virtual serial console, so the clock can be set up by a script as well as by hand.
+// The case of the commands doesn't matter, the fields are separated by spaces:
+//
+// STATUS                          Local time, UTC, zone, hand positions and settings as key=value pairs on the OK line, trim is the drift
+//                                 trim of the rtc in ppb and error how far it might be off in ms (none without SYNC TIME),
+//                                 late, maxlate (ms), missed and catchups how the alarms kept up since boot,
+//                                 state the current power state
+// SET TIME dd.mm.yy hh:mm[:ss]    Starts the clock at the local time and moves the hands to it, the hands need to be homed.
+//                                 Takes ISO 8601 (yyyy-mm-ddThh:mm[:ss]) and unix time (UTC) as well, see DateTimeParser.c
+// SET ZONE name                   Time zone of the hands by its tz database name (Europe/Berlin), UTC by default.
+//                                 The rtc runs in UTC, the hands follow daylight saving time on their own
+// ZONES                           Lists the zones the clock knows
+// SET ANIM ON hh hh | OFF         Hourly animations from the first to the second hour, OFF also ends the one that plays
+// SET BRIGHTNESS 0-255            Brightness of the animations
+// SET PATTERN n | RANDOM          Pattern of the hourly animation
+// SET INVERT HOUR|MINUTE ON|OFF   Runs the step sequence of a motor the other way round
+// SET HOLD HOUR|MINUTE mode [n]   What the coils of a motor do once it settled after a step: FULL stays on, REDUCED n drops
+//                                 to n percent of the running duty, RELEASE switches them off
+// STEP HOUR|MINUTE n              Moves a hand n steps clockwise (counterclockwise when negative), stops the clock
+// HOME [HOUR|MINUTE]              The hands point to 12 o'clock now, stops the clock
+// SYNC                            Replies with the timer (time_us_64) at which the line came in and at which the reply went out
+// SYNC TIME t us                  Starts the clock at the time t (as for SET TIME, without spaces) when the timer reaches us,
+//                                 at most SYNC_MAX_WAIT_US ahead, and moves the hands to it
+// LOG DUMP                        Prints the event log
+// TRACE DUMP                      Prints the handler trace (-DTRACE=ON builds)
+// HELP                            Lists the commands
+//
+// Every command ends with exactly one line that starts with OK or ERR, whatever the command prints comes before it.
+// A script can send all of its commands at once and read the replies back. The settings get saved to flash once
+// the commands that have come in so far are done.
+//
+// SYNC and SYNC TIME are for a time sync tool on the host (Host/ClockSync.c). It sends a few SYNCs and works out how
+// the timer relates to its own clock from the send and receive times on both ends, like NTP does, taking the one with
+// the shortest round trip. It then picks the start of a second shortly ahead, and SYNC TIME starts the rtc right then.
+// The rtc counts whole seconds, starting it on the timer is what gets the clock within milliseconds.
+//
+// The usb irq only posts a work item when chars come in. The chars are read and the commands run from the work queue
+// in thread mode, the core sleeps in between.
+
+/// @brief Chars of the line that is being received.
+static char line[128];
+static uint32_t lineLength = 0;
+
+/// @brief Set when the line didn't fit, the rest of it gets dropped.
+static bool lineTooLong = false;
+
+/// @brief Bits for the hands that point to where their stepper thinks they are.
+#define HOUR_HAND 0x1
+#define MINUTE_HAND 0x2
+static uint32_t homedHands = 0;
+
+/// @brief Set while the rtc alarm is off because a hand got moved or homed by a command.
+static bool clockStopped = false;
+
+/// @brief Timer (time_us_64) at which chars came in last, the receive time of SYNC.
+static uint64_t inputArrivedAt = 0;
+
+/// @brief How far ahead SYNC TIME may start the rtc, the console doesn't take commands while it waits.
+#define SYNC_MAX_WAIT_US 2000000
+
+/// @brief Returns the next field of the arguments and moves the cursor behind it.
+/// @return The field or an empty string when there are no more fields.
+static char *nextField(char **cursor)
+{
+    char *field = *cursor;
+    while (*field == ' ')
+        field++;
+
+    char *end = field;
+    while (*end != ' ' && *end != '\0')
+        end++;
+
+    *cursor = end;
+    if (*end != '\0')
+    {
+        *end = '\0';
+        (*cursor)++;
+    }
+
+    return field;
+}
+
+/// @brief Parses ON or OFF.
+static bool parseOnOff(const char *field, bool *value)
+{
+    if (strcmp(field, "ON") == 0)
+        *value = true;
+    else if (strcmp(field, "OFF") == 0)
+        *value = false;
+    else
+        return false;
+
+    return true;
+}
+
+/// @brief Parses a decimal number in the given range.
+static bool parseNumber(const char *field, int32_t min, int32_t max, int32_t *value)
+{
+    char *end;
+    long number = strtol(field, &end, 10);
+
+    if (*field == '\0' || *end != '\0' || number < min || number > max)
+        return false;
+
+    *value = number;
+    return true;
+}
+
+/// @brief Parses HOUR or MINUTE.
+/// @return The bit of the hand or 0.
+static uint32_t parseHand(const char *field)
+{
+    if (strcmp(field, "HOUR") == 0)
+        return HOUR_HAND;
+    if (strcmp(field, "MINUTE") == 0)
+        return MINUTE_HAND;
+
+    return 0;
+}
+
+/// @brief Parses the time of SET TIME and SYNC TIME into the time of the rtc. Unix time already is UTC,
+/// the other formats are the local time of the configured zone and can't be in the first or the last year of the rtc.
+static bool parseTime(const char *field, datetime_t *utc)
+{
+    struct dateTimeParser parser;
+    datetime_t t;
+
+    dateTimeParserInit(&parser);
+    for (const char *c = field; *c != '\0'; c++)
+        if (!dateTimeParserFeed(&parser, *c))
+            return false;
+
+    if (!dateTimeParserFinish(&parser, &t))
+        return false;
+
+    if (dateTimeParserIsUnixTime(&parser))
+    {
+        *utc = t;
+        return true;
+    }
+
+    if (t.year <= 1970 || t.year >= 4095)
+        return false;
+
+    timeZoneToUtc(&t, utc);
+    return true;
+}
+
+/// @brief Set by the commands that change a setting. The settings get saved once all commands that have come in are done,
+/// so a script that sets several of them only has the flash written once and not in the middle of a seek.
+static bool configChanged = false;
+
+/// @brief Stops the clock for a command that moves the hands. It starts again with SET TIME.
+static void stopClock()
+{
+    disableRtcAlarm();
+
+    // A reset from here on needs the time set again
+    warmStartInvalidate();
+    clockStopped = true;
+}
+
+/// @brief Names of enum stepperHoldMode as SET HOLD takes them.
+static const char *const holdModes[] = {"FULL", "REDUCED", "RELEASE"};
+
+static void commandStatus(char *arguments)
+{
+    printf("OK");
+
+    datetime_t t;
+    if (rtcGetLocalTime(&t))
+        printf(" time=%04d-%02d-%02dT%02d:%02d:%02d", t.year, t.month, t.day, t.hour, t.min, t.sec);
+    else
+        printf(" time=none");
+
+    // Until the time is set the rtc runs in the local time the hands showed
+    if (rtcIsTimeSet() && rtc_get_datetime(&t))
+        printf(" utc=%04d-%02d-%02dT%02d:%02d:%02d offset=%ld", t.year, t.month, t.day, t.hour, t.min, t.sec,
+               (long)timeZoneGetOffset(&t));
+    else
+        printf(" utc=none offset=none");
+
+    printf(" zone=%s", timeZoneGetName());
+
+    printf(" timeset=%d stopped=%d homed=%d hour=%lu minute=%lu",
+           rtcIsTimeSet(), clockStopped, homedHands == (HOUR_HAND | MINUTE_HAND),
+           (unsigned long)stepperGetPosition(&hourStepper), (unsigned long)stepperGetPosition(&minuteStepper));
+
+    printf(" anim=%d start=%02d end=%02d brightness=%d pattern=%d inverthour=%d invertminute=%d",
+           config.enableHourlyAnimation, config.animationStartHour, config.animationEndHour,
+           config.brightness, config.pattern, config.invertHour, config.invertMinute);
+
+    printf(" holdhour=%s dutyhour=%d holdminute=%s dutyminute=%d", holdModes[config.holdHour], config.holdDutyHour,
+           holdModes[config.holdMinute], config.holdDutyMinute);
+
+    // The state the clocks are in now and where the time went while running from the battery
+    printf(" state=%s", powerGetStateName(powerGetState()));
+    for (uint32_t state = 0; state < POWER_STATE_COUNT; state++)
+        printf(" %s=%llu", powerGetStateName(state), (unsigned long long)(powerGetTimeInState(state) / 1000000));
+
+    // Drift trim and how far the rtc might be off by now
+    uint64_t error;
+    printf(" trim=%ld", (long)config.rtcTrimPpb);
+    if (rtcGetEstimatedError(&error))
+        printf(" error=%llu", (unsigned long long)(error / 1000));
+    else
+        printf(" error=none");
+
+    // Alarms that came late or not at all and how often the hands had to catch up
+    struct rtcAlarmStatistics alarms;
+    rtcGetAlarmStatistics(&alarms);
+    printf(" late=%lu maxlate=%llu missed=%lu catchups=%lu", (unsigned long)alarms.late, (unsigned long long)(alarms.maxLateUs / 1000),
+           (unsigned long)alarms.missed, (unsigned long)alarms.catchUps);
+
+    printf(" events=%lu boots=%lu\n", (unsigned long)eventLogGetCount(), (unsigned long)eventLog.boots);
+}
+
+/// @brief Starts the rtc at the time and moves the hands to it while the rtc runs.
+/// @param startAt Timer (time_us_64) at which the rtc starts counting, 0 for right away.
+static void startClock(datetime_t *t, uint64_t startAt)
+{
+    // The hands don't move on their own while they are moved to the time
+    disableRtcAlarm();
+    warmStartInvalidate();
+
+    // A power loss during the seek leaves the hands somewhere in between
+    handJournalInvalidate();
+
+    if (startAt != 0)
+        rtcSync(t, startAt);
+    else
+        rtcStart(t, true);
+
+    rtcSeekHands();
+    clockStopped = false;
+}
+
+static void commandSetTime(char *arguments)
+{
+    datetime_t dateAndTime = {};
+
+    if (homedHands != (HOUR_HAND | MINUTE_HAND))
+    {
+        puts("ERR NOT HOMED");
+        return;
+    }
+
+    while (*arguments == ' ')
+        arguments++;
+
+    if (!parseTime(arguments, &dateAndTime))
+    {
+        puts("ERR BAD TIME");
+        return;
+    }
+
+    // The rtc starts counting the second the line came in, not after the seek
+    startClock(&dateAndTime, 0);
+    puts("OK");
+}
+
+static void commandSync(char *arguments)
+{
+    printf("OK rx=%llu tx=%llu\n", (unsigned long long)inputArrivedAt, (unsigned long long)time_us_64());
+}
+
+static void commandSyncTime(char *arguments)
+{
+    datetime_t dateAndTime = {};
+
+    if (homedHands != (HOUR_HAND | MINUTE_HAND))
+    {
+        puts("ERR NOT HOMED");
+        return;
+    }
+
+    if (!parseTime(nextField(&arguments), &dateAndTime))
+    {
+        puts("ERR BAD TIME");
+        return;
+    }
+
+    char *field = nextField(&arguments);
+    char *end;
+    uint64_t startAt = strtoull(field, &end, 10);
+    uint64_t now = time_us_64();
+
+    // Too late means the sync has to be done again, the round trip took longer than the tool allowed for
+    if (*field == '\0' || *end != '\0' || startAt <= now || startAt > now + SYNC_MAX_WAIT_US)
+    {
+        puts("ERR BAD START");
+        return;
+    }
+
+    startClock(&dateAndTime, startAt);
+
+    // The drift might have been learned
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetAnimation(char *arguments)
+{
+    bool enable;
+    if (!parseOnOff(nextField(&arguments), &enable))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    if (enable)
+    {
+        int32_t startHour;
+        int32_t endHour;
+
+        if (!parseNumber(nextField(&arguments), 0, 23, &startHour) || !parseNumber(nextField(&arguments), 0, 23, &endHour))
+        {
+            puts("ERR BAD HOUR");
+            return;
+        }
+
+        config.animationStartHour = startHour;
+        config.animationEndHour = endHour;
+    }
+
+    // A pattern that is playing right now ends early
+    if (!enable)
+        ws2812_stop_pattern();
+
+    config.enableHourlyAnimation = enable;
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetBrightness(char *arguments)
+{
+    int32_t brightness;
+    if (!parseNumber(nextField(&arguments), 0, 255, &brightness))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    config.brightness = brightness;
+    ws2812_set_brightness(brightness);
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetPattern(char *arguments)
+{
+    char *field = nextField(&arguments);
+    int32_t pattern = WS2812_RANDOM_PATTERN;
+
+    if (strcmp(field, "RANDOM") != 0 && !parseNumber(field, 0, ws2812_get_pattern_count() - 1, &pattern))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    config.pattern = pattern;
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetInvert(char *arguments)
+{
+    uint32_t hand = parseHand(nextField(&arguments));
+    bool inverted;
+
+    if (hand == 0 || !parseOnOff(nextField(&arguments), &inverted))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    if (hand == HOUR_HAND)
+    {
+        config.invertHour = inverted;
+        stepperSetInverted(&hourStepper, inverted);
+    }
+    else
+    {
+        config.invertMinute = inverted;
+        stepperSetInverted(&minuteStepper, inverted);
+    }
+
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetHold(char *arguments)
+{
+    uint32_t hand = parseHand(nextField(&arguments));
+    char *field = nextField(&arguments);
+    int32_t mode = -1;
+    int32_t duty = 0;
+
+    for (uint32_t i = 0; i < count_of(holdModes); i++)
+        if (strcmp(field, holdModes[i]) == 0)
+            mode = i;
+
+    if (hand == 0 || mode < 0 || (mode == STEPPER_HOLD_REDUCED && !parseNumber(nextField(&arguments), 1, 100, &duty)))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    if (hand == HOUR_HAND)
+    {
+        config.holdHour = mode;
+        config.holdDutyHour = duty;
+        stepperSetHold(&hourStepper, mode, duty);
+    }
+    else
+    {
+        config.holdMinute = mode;
+        config.holdDutyMinute = duty;
+        stepperSetHold(&minuteStepper, mode, duty);
+    }
+
+    configChanged = true;
+    puts("OK");
+}
+
+static void commandSetZone(char *arguments)
+{
+    int32_t zone = timeZoneFind(nextField(&arguments));
+    if (zone < 0)
+    {
+        puts("ERR BAD ZONE");
+        return;
+    }
+
+    config.timeZone = zone;
+    configChanged = true;
+
+    // The rtc keeps running in UTC, only the hands move
+    rtcZoneChanged();
+    puts("OK");
+}
+
+static void commandZones(char *arguments)
+{
+    for (uint32_t i = 0; i < timeZoneCount; i++)
+        puts(timeZones[i].name);
+
+    puts("OK");
+}
+
+static void commandStep(char *arguments)
+{
+    uint32_t hand = parseHand(nextField(&arguments));
+    int32_t steps;
+
+    if (hand == 0 || !parseNumber(nextField(&arguments), -STEPS_PER_REVOLUTION, STEPS_PER_REVOLUTION, &steps))
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    stopClock();
+
+    // The journal only keeps positions that are known, a hand that isn't homed yet doesn't get any more known by moving it
+    if (homedHands == (HOUR_HAND | MINUTE_HAND))
+        handJournalInvalidate();
+
+    seekMoveHand(hand == HOUR_HAND ? &hourStepper : &minuteStepper, steps);
+
+    if (homedHands == (HOUR_HAND | MINUTE_HAND))
+        handJournalSave();
+
+    puts("OK");
+}
+
+static void commandHome(char *arguments)
+{
+    char *field = nextField(&arguments);
+    uint32_t hands = *field == '\0' ? HOUR_HAND | MINUTE_HAND : parseHand(field);
+
+    if (hands == 0)
+    {
+        puts("ERR BAD VALUE");
+        return;
+    }
+
+    stopClock();
+
+    if (hands & HOUR_HAND)
+        stepperSetHome(&hourStepper);
+    if (hands & MINUTE_HAND)
+        stepperSetHome(&minuteStepper);
+
+    homedHands |= hands;
+
+    // From now on the hands don't need to be homed again after a power loss
+    if (homedHands == (HOUR_HAND | MINUTE_HAND))
+        handJournalSave();
+
+    puts("OK");
+}
+
+static void commandLogDump(char *arguments)
+{
+    eventLogDump();
+    puts("OK");
+}
+
+static void commandTraceDump(char *arguments)
+{
+#if TRACE_ENABLED
+    traceDump();
+    puts("OK");
+#else
+    puts("ERR TRACE DISABLED");
+#endif
+}
+
+static void commandHelp(char *arguments);
+
+struct command
+{
+    /// @brief The words that make up the command in upper case.
+    const char *name;
+
+    /// @brief Runs the command with the rest of the line and prints the reply.
+    void (*run)(char *arguments);
+};
+
+static const struct command commands[] = {
+    {"STATUS", commandStatus},
+    {"SET TIME", commandSetTime},
+    {"SET ANIM", commandSetAnimation},
+    {"SET BRIGHTNESS", commandSetBrightness},
+    {"SET PATTERN", commandSetPattern},
+    {"SET INVERT", commandSetInvert},
+    {"SET HOLD", commandSetHold},
+    {"SET ZONE", commandSetZone},
+    {"ZONES", commandZones},
+    {"STEP", commandStep},
+    {"HOME", commandHome},
+    {"SYNC TIME", commandSyncTime},
+    {"SYNC", commandSync},
+    {"LOG DUMP", commandLogDump},
+    {"TRACE DUMP", commandTraceDump},
+    {"HELP", commandHelp},
+};
+
+static void commandHelp(char *arguments)
+{
+    for (uint32_t i = 0; i < count_of(commands); i++)
+        puts(commands[i].name);
+
+    puts("OK");
+}
+
+/// @brief Looks up the command the line starts with and runs it.
+static void runLine(char *text)
+{
+    for (char *c = text; *c != '\0'; c++)
+        if (*c >= 'a' && *c <= 'z')
+            *c -= 'a' - 'A';
+
+    while (*text == ' ')
+        text++;
+
+    for (uint32_t i = 0; i < count_of(commands); i++)
+    {
+        uint32_t length = strlen(commands[i].name);
+        if (strncmp(text, commands[i].name, length) == 0 && (text[length] == ' ' || text[length] == '\0'))
+        {
+            commands[i].run(&text[length]);
+            return;
+        }
+    }
+
+    puts("ERR UNKNOWN COMMAND");
+}
+
+/// @brief Reads all chars that have come in and runs the commands of the complete lines.
+static void consoleInputWork(struct workItem *item)
+{
+    // Commands that wait for a seek run the work queue meanwhile. What comes in then is left for the loop
+    // below or the next run, so a command never runs inside another one.
+    static bool running = false;
+    static bool postedWhileRunning = false;
+    if (running)
+    {
+        postedWhileRunning = true;
+        return;
+    }
+    running = true;
+    postedWhileRunning = false;
+
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
+    {
+        if (c == '\n' || c == '\r')
+        {
+            line[lineLength] = '\0';
+
+            // Empty lines (like the second half of \r\n) get no reply
+            if (lineTooLong)
+                puts("ERR TOO LONG");
+            else if (lineLength > 0)
+                runLine(line);
+
+            lineLength = 0;
+            lineTooLong = false;
+            continue;
+        }
+
+        // Only printable ascii
+        if (c < ' ' || c > '~')
+            continue;
+
+        if (lineLength < count_of(line) - 1)
+            line[lineLength++] = c;
+        else
+            lineTooLong = true;
+    }
+
+    if (configChanged)
+    {
+        configSave();
+        configChanged = false;
+    }
+
+    running = false;
+    if (postedWhileRunning)
+        workQueuePost(item);
+}
+
+static struct workItem inputWork = WORK_ITEM_INIT(consoleInputWork);
+
+/// @brief Called by the usb stack from its irq when chars came in.
+static void consoleCharsAvailable(void *param)
+{
+    inputArrivedAt = time_us_64();
+    workQueuePost(&inputWork);
+}
+
+/// @brief Sets up the console once at boot.
+/// @param handsHomed true when the positions of both hands are known from before the reset.
+void consoleInit(bool handsHomed)
+{
+    homedHands = handsHomed ? HOUR_HAND | MINUTE_HAND : 0;
+}
+
+/// @brief Starts taking commands once usb is up.
+void consoleStart()
+{
+    lineLength = 0;
+    lineTooLong = false;
+
+    stdio_set_chars_available_callback(consoleCharsAvailable, NULL);
+
+    // Chars that came in before the callback was set don't call it
+    workQueuePost(&inputWork);
+}
+
+/// @brief Stops taking commands before usb goes away.
+void consoleStop()
+{
+    stdio_set_chars_available_callback(NULL, NULL);
+}
@@ -0,0 +1,10 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "pico/types.h"
+
+void consoleInit(bool handsHomed);
+void consoleStart();
+void consoleStop();
+
+#endif
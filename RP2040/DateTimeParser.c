@@ -0,0 +1,293 @@
+#include <string.h>
+
+#include "pico.h"
+
+#include "DateTimeParser.h"
+
+// Parses a date and time a char at a time, so it can be fed straight from the serial console as the chars come in.
+// The input can be in any of the formats of the table below, which one it is becomes clear with the first separator:
+//
+// dd.mm.yy hh:mm[:ss]          01.01.24 11:59
+// yyyy-mm-ddThh:mm[:ss]        2024-01-01T11:59:30 (ISO 8601, a space instead of the T works too)
+// seconds since 1970           1704110370 (unix time)
+//
+// Seconds since 1970 are UTC, the other formats are the local time of the zone of the clock (see TimeZone.c).
+
+/// @brief A field of a format and the chars that may separate it from the field before.
+struct dateTimeFormatField
+{
+    /// @brief Chars that may come before the field, NULL for the first field.
+    const char *separators;
+
+    uint8_t minDigits;
+    uint8_t maxDigits;
+
+    /// @brief Where the value goes (enum dateTimeField).
+    uint8_t target;
+
+    /// @brief Added to the value, for two digit years.
+    uint16_t offset;
+};
+
+struct dateTimeFormat
+{
+    const struct dateTimeFormatField *fields;
+
+    /// @brief Number of fields and how many of them have to be there, the rest (the seconds) is optional.
+    uint8_t count;
+    uint8_t required;
+};
+
+static const struct dateTimeFormatField dottedFields[] = {
+    {NULL, 2, 2, DATE_TIME_DAY, 0},
+    {".", 2, 2, DATE_TIME_MONTH, 0},
+    {".", 2, 2, DATE_TIME_YEAR, 2000},
+    {" ", 2, 2, DATE_TIME_HOUR, 0},
+    {":", 2, 2, DATE_TIME_MINUTE, 0},
+    {":", 2, 2, DATE_TIME_SECOND, 0},
+};
+
+static const struct dateTimeFormatField isoFields[] = {
+    {NULL, 4, 4, DATE_TIME_YEAR, 0},
+    {"-", 2, 2, DATE_TIME_MONTH, 0},
+    {"-", 2, 2, DATE_TIME_DAY, 0},
+    {"T ", 2, 2, DATE_TIME_HOUR, 0},
+    {":", 2, 2, DATE_TIME_MINUTE, 0},
+    {":", 2, 2, DATE_TIME_SECOND, 0},
+};
+
+static const struct dateTimeFormatField epochFields[] = {
+    {NULL, 1, DATE_TIME_PARSER_MAX_DIGITS, DATE_TIME_EPOCH, 0},
+};
+
+static const struct dateTimeFormat formats[] = {
+    {dottedFields, count_of(dottedFields), 5},
+    {isoFields, count_of(isoFields), 5},
+    {epochFields, count_of(epochFields), 1},
+};
+
+/// @brief The rtc counts years up to 4095.
+#define MAX_YEAR 4095
+
+/// @brief Resets the parser for a new date and time.
+void dateTimeParserInit(struct dateTimeParser *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+}
+
+static bool digitsFit(const struct dateTimeFormatField *field, uint8_t digits)
+{
+    return digits >= field->minDigits && digits <= field->maxDigits;
+}
+
+static bool isSeparator(const struct dateTimeFormatField *field, char c)
+{
+    return c != '\0' && strchr(field->separators, c) != NULL;
+}
+
+/// @brief Stores the value of the field that has been read and gets ready for the next one.
+static void endField(struct dateTimeParser *parser)
+{
+    const struct dateTimeFormatField *field = &parser->format->fields[parser->field];
+
+    parser->values[field->target] = parser->value + field->offset;
+    parser->field++;
+    parser->digits = 0;
+    parser->value = 0;
+}
+
+static bool fail(struct dateTimeParser *parser)
+{
+    parser->failed = true;
+    return false;
+}
+
+/// @brief Takes the next char of the input.
+/// @return false once the input can't be a date and time anymore, the rest of it can be dropped then.
+bool dateTimeParserFeed(struct dateTimeParser *parser, char c)
+{
+    if (parser->failed)
+        return false;
+
+    if (c >= '0' && c <= '9')
+    {
+        uint8_t maxDigits = parser->format != NULL ? parser->format->fields[parser->field].maxDigits : DATE_TIME_PARSER_MAX_DIGITS;
+        if (parser->digits == maxDigits)
+            return fail(parser);
+
+        parser->value = parser->value * 10 + (c - '0');
+        parser->digits++;
+        return true;
+    }
+
+    // The first separator tells the formats apart
+    if (parser->format == NULL)
+    {
+        for (uint32_t i = 0; i < count_of(formats) && parser->format == NULL; i++)
+            if (formats[i].count > 1 && digitsFit(&formats[i].fields[0], parser->digits) && isSeparator(&formats[i].fields[1], c))
+                parser->format = &formats[i];
+
+        if (parser->format == NULL)
+            return fail(parser);
+    }
+    else if (parser->field + 1 >= parser->format->count ||
+             !digitsFit(&parser->format->fields[parser->field], parser->digits) ||
+             !isSeparator(&parser->format->fields[parser->field + 1], c))
+        return fail(parser);
+
+    endField(parser);
+    return true;
+}
+
+static bool isLeapYear(int64_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static uint32_t daysInMonth(int64_t year, uint32_t month)
+{
+    static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+/// @brief Days since 1970-01-01 of a date of the gregorian calendar.
+static int64_t daysFromDate(int64_t year, uint32_t month, uint32_t day)
+{
+    // Counted from march, so the leap day is the last day of the year
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/// @brief The other way round of daysFromDate, for days since 1970 (not before).
+static void dateFromDays(int64_t days, int64_t *year, uint32_t *month, uint32_t *day)
+{
+    days += 719468;
+    int64_t era = days / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthFromMarch = (5 * dayOfYear + 2) / 153;
+
+    *day = dayOfYear - (153 * monthFromMarch + 2) / 5 + 1;
+    *month = monthFromMarch < 10 ? monthFromMarch + 3 : monthFromMarch - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/// @brief Ends the input and checks the date and time against the calendar.
+/// @param dateTime Gets the date and time including the day of the week (0 is sunday). Seconds that weren't given are zero.
+/// @return true when the input was a complete and valid date and time.
+bool dateTimeParserFinish(struct dateTimeParser *parser, datetime_t *dateTime)
+{
+    if (parser->failed)
+        return false;
+
+    // Only digits, that can only be a format with a single field
+    if (parser->format == NULL)
+    {
+        for (uint32_t i = 0; i < count_of(formats) && parser->format == NULL; i++)
+            if (formats[i].count == 1 && digitsFit(&formats[i].fields[0], parser->digits))
+                parser->format = &formats[i];
+
+        if (parser->format == NULL)
+            return fail(parser);
+    }
+    else if (!digitsFit(&parser->format->fields[parser->field], parser->digits))
+        return fail(parser);
+
+    endField(parser);
+    if (parser->field < parser->format->required)
+        return fail(parser);
+
+    uint64_t *values = parser->values;
+    int64_t year;
+    uint32_t month;
+    uint32_t day;
+    int64_t days;
+
+    if (parser->format->fields[0].target == DATE_TIME_EPOCH)
+    {
+        days = values[DATE_TIME_EPOCH] / 86400;
+        dateFromDays(days, &year, &month, &day);
+
+        uint32_t seconds = values[DATE_TIME_EPOCH] % 86400;
+        values[DATE_TIME_HOUR] = seconds / 3600;
+        values[DATE_TIME_MINUTE] = (seconds / 60) % 60;
+        values[DATE_TIME_SECOND] = seconds % 60;
+    }
+    else
+    {
+        year = values[DATE_TIME_YEAR];
+        month = values[DATE_TIME_MONTH];
+        day = values[DATE_TIME_DAY];
+
+        if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+            return fail(parser);
+
+        days = daysFromDate(year, month, day);
+    }
+
+    if (year > MAX_YEAR || values[DATE_TIME_HOUR] > 23 || values[DATE_TIME_MINUTE] > 59 || values[DATE_TIME_SECOND] > 59)
+        return fail(parser);
+
+    dateTime->year = year;
+    dateTime->month = month;
+    dateTime->day = day;
+    dateTime->dotw = ((days % 7) + 11) % 7; // 1970-01-01 was a thursday
+    dateTime->hour = values[DATE_TIME_HOUR];
+    dateTime->min = values[DATE_TIME_MINUTE];
+    dateTime->sec = values[DATE_TIME_SECOND];
+    return true;
+}
+
+/// @brief Seconds since 1970 of a date and time, the other way round of the unix time format.
+int64_t dateTimeToSeconds(const datetime_t *dateTime)
+{
+    return daysFromDate(dateTime->year, dateTime->month, dateTime->day) * 86400 +
+           dateTime->hour * 3600 + dateTime->min * 60 + dateTime->sec;
+}
+
+/// @brief The other way round of dateTimeToSeconds, for times from 1970 on.
+void dateTimeFromSeconds(int64_t seconds, datetime_t *dateTime)
+{
+    int64_t days = seconds / 86400;
+    int64_t year;
+    uint32_t month;
+    uint32_t day;
+    dateFromDays(days, &year, &month, &day);
+
+    dateTime->year = year;
+    dateTime->month = month;
+    dateTime->day = day;
+    dateTime->dotw = (days + 4) % 7; // 1970-01-01 was a thursday
+    dateTime->hour = (seconds % 86400) / 3600;
+    dateTime->min = (seconds % 3600) / 60;
+    dateTime->sec = seconds % 60;
+}
+
+/// @brief Tells whether the input was in seconds since 1970, which count in UTC unlike the other formats.
+/// Only valid after dateTimeParserFinish returned true.
+bool dateTimeParserIsUnixTime(const struct dateTimeParser *parser)
+{
+    return parser->format->fields[0].target == DATE_TIME_EPOCH;
+}
+
+/// @brief Parses a date and time that is there as a whole.
+/// @param text The date and time in one of the formats above.
+/// @param length Number of chars of the text.
+/// @param dateTime Gets the date and time.
+/// @return true when the text was a valid date and time.
+bool dateTimeParse(const char *text, uint32_t length, datetime_t *dateTime)
+{
+    struct dateTimeParser parser;
+    dateTimeParserInit(&parser);
+
+    for (uint32_t i = 0; i < length; i++)
+        if (!dateTimeParserFeed(&parser, text[i]))
+            return false;
+
+    return dateTimeParserFinish(&parser, dateTime);
+}
@@ -0,0 +1,53 @@
+#ifndef DATE_TIME_PARSER_H
+#define DATE_TIME_PARSER_H
+
+#include "pico/types.h"
+
+/// @brief Most digits of a single field, enough for a unix time up to the year 4095.
+#define DATE_TIME_PARSER_MAX_DIGITS 11
+
+/// @brief Fields a date and time gets split into.
+enum dateTimeField
+{
+    DATE_TIME_YEAR,
+    DATE_TIME_MONTH,
+    DATE_TIME_DAY,
+    DATE_TIME_HOUR,
+    DATE_TIME_MINUTE,
+    DATE_TIME_SECOND,
+    DATE_TIME_EPOCH,
+
+    DATE_TIME_FIELD_COUNT
+};
+
+struct dateTimeFormat;
+
+/// @brief Incremental parser for one date and time. Gets the input a char at a time as it comes in.
+struct dateTimeParser
+{
+    /// @brief The format the input turned out to be in, NULL while only digits have come in.
+    const struct dateTimeFormat *format;
+
+    /// @brief Index of the field of the format that is being read.
+    uint8_t field;
+
+    /// @brief Digits of that field so far and their value.
+    uint8_t digits;
+    uint64_t value;
+
+    /// @brief Set once the input can't be a date and time anymore.
+    bool failed;
+
+    /// @brief Fields that have been read completely.
+    uint64_t values[DATE_TIME_FIELD_COUNT];
+};
+
+void dateTimeParserInit(struct dateTimeParser *parser);
+bool dateTimeParserFeed(struct dateTimeParser *parser, char c);
+bool dateTimeParserFinish(struct dateTimeParser *parser, datetime_t *dateTime);
+bool dateTimeParserIsUnixTime(const struct dateTimeParser *parser);
+bool dateTimeParse(const char *text, uint32_t length, datetime_t *dateTime);
+int64_t dateTimeToSeconds(const datetime_t *dateTime);
+void dateTimeFromSeconds(int64_t seconds, datetime_t *dateTime);
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdio.h>
+
+#include "hardware/watchdog.h"
+#include "pico/stdlib.h"
+
+#include "EventLog.h"
+
+#define EVENT_LOG_MAGIC 0x45564c47 // "EVLG"
+
+/// @brief Not touched by the startup code, so whatever was logged before a reset is still there.
+struct eventLog __uninitialized_ram(eventLog);
+
+/// @brief Picks up the log of the previous runs or starts a new one if the ram doesn't hold one (power on),
+/// then logs the boot.
+void eventLogInit()
+{
+    if (eventLog.magic != EVENT_LOG_MAGIC || eventLog.magicComplement != ~EVENT_LOG_MAGIC)
+    {
+        eventLog.head = 0;
+        eventLog.boots = 0;
+        eventLog.magic = EVENT_LOG_MAGIC;
+        eventLog.magicComplement = ~EVENT_LOG_MAGIC;
+    }
+
+    eventLog.boots++;
+    eventLogWrite(EVENT_BOOT, watchdog_caused_reboot(), eventLog.boots);
+}
+
+/// @brief Returns the number of entries the log holds.
+uint32_t eventLogGetCount()
+{
+    return eventLog.head < EVENT_LOG_LENGTH ? eventLog.head : EVENT_LOG_LENGTH;
+}
+
+/// @brief Prints the log from the oldest to the newest entry to stdout (the usb console).
+void eventLogDump()
+{
+    static const char *const typeNames[] = {"?", "boot", "coils", "rtc alarm", "pattern", "seek begin", "seek end", "rtc sync", "rtc trim", "rtc late", "time zone"};
+
+    uint32_t count = eventLogGetCount();
+    uint32_t head = eventLog.head;
+
+    printf("Event log: %lu entries, %lu boots\n", (unsigned long)count, (unsigned long)eventLog.boots);
+    for (uint32_t i = head - count; i != head; i++)
+    {
+        struct eventLogEntry entry = eventLog.entries[i % EVENT_LOG_LENGTH];
+        const char *name = entry.type < count_of(typeNames) ? typeNames[entry.type] : "?";
+
+        switch (entry.type)
+        {
+        case EVENT_COILS:
+            printf("%10lu %-10s mask %02x values %02x\n", (unsigned long)entry.time, name, entry.a, entry.b);
+            break;
+        case EVENT_RTC_ALARM:
+            printf("%10lu %-10s %02u:%02u\n", (unsigned long)entry.time, name, entry.a, entry.b);
+            break;
+        case EVENT_RTC_SYNC:
+            printf("%10lu %-10s %dms behind%s\n", (unsigned long)entry.time, name, (int16_t)entry.b, entry.a ? ", drift learned" : "");
+            break;
+        case EVENT_RTC_TRIM:
+            printf("%10lu %-10s %dus\n", (unsigned long)entry.time, name, (int16_t)entry.b);
+            break;
+        case EVENT_TIME_ZONE:
+            printf("%10lu %-10s %+d minutes\n", (unsigned long)entry.time, name, (int16_t)entry.b);
+            break;
+        case EVENT_RTC_LATE:
+            printf("%10lu %-10s %ums, %u minutes missed\n", (unsigned long)entry.time, name, entry.b, entry.a);
+            break;
+        default:
+            printf("%10lu %-10s %u %u\n", (unsigned long)entry.time, name, entry.a, entry.b);
+            break;
+        }
+    }
+}
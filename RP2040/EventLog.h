@@ -0,0 +1,91 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "hardware/sync.h"
+#include "pico/types.h"
+#include "hardware/timer.h"
+
+// Binary log of what the clock did, kept in ram that isn't cleared at boot so it survives watchdog and soft resets.
+// Cheap enough to stay on in the hot paths: an entry is two words written with interrupts held off for the index only.
+
+/// @brief Number of entries kept, needs to be a power of two. 8 bytes each.
+#define EVENT_LOG_LENGTH 512
+
+enum eventLogType
+{
+    /// @brief The firmware started. a: 1 when the watchdog caused the reboot, b: number of boots the log has seen.
+    EVENT_BOOT = 1,
+
+    /// @brief Coils of the steppers written. a: gpio mask, b: gpio values, both of gpio 0 to 7.
+    EVENT_COILS,
+
+    /// @brief Rtc alarm. a: hour, b: minute, of the local time.
+    EVENT_RTC_ALARM,
+
+    /// @brief Led pattern started. a: pattern index or WS2812_RANDOM_PATTERN.
+    EVENT_PATTERN,
+
+    /// @brief Seek started. a: target position of the hour hand, b: target position of the minute hand.
+    EVENT_SEEK_BEGIN,
+
+    /// @brief Seek done. a: position of the hour hand, b: position of the minute hand.
+    EVENT_SEEK_END,
+
+    /// @brief SYNC TIME measured the rtc. a: 1 when the drift got learned from it, b: how far the rtc was behind in ms (signed).
+    EVENT_RTC_SYNC,
+
+    /// @brief Drift trim applied. b: how far the rtc got moved ahead in us (signed).
+    EVENT_RTC_TRIM,
+
+    /// @brief Rtc alarm came late or after minutes without one. a: minutes missed, b: how late it was in ms.
+    EVENT_RTC_LATE,
+
+    /// @brief Daylight saving time started or ended. b: offset from UTC in minutes from now on (signed).
+    EVENT_TIME_ZONE,
+};
+
+struct eventLogEntry
+{
+    /// @brief time_us_32 when the event happened, wraps every 71 minutes and starts over at every boot.
+    uint32_t time;
+
+    uint8_t type;
+    uint8_t a;
+    uint16_t b;
+};
+
+struct eventLog
+{
+    /// @brief EVENT_LOG_MAGIC and its complement when the ram holds a log, random after power on.
+    uint32_t magic;
+    uint32_t magicComplement;
+
+    /// @brief Number of entries ever written, the next one goes to head % EVENT_LOG_LENGTH.
+    uint32_t head;
+
+    uint32_t boots;
+
+    struct eventLogEntry entries[EVENT_LOG_LENGTH];
+};
+
+extern struct eventLog eventLog;
+
+/// @brief Appends an event to the log. Can be called from interrupt handlers.
+static inline void eventLogWrite(enum eventLogType type, uint8_t a, uint16_t b)
+{
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t index = eventLog.head++ % EVENT_LOG_LENGTH;
+    restore_interrupts(status);
+
+    struct eventLogEntry *entry = &eventLog.entries[index];
+    entry->time = time_us_32();
+    entry->type = type;
+    entry->a = a;
+    entry->b = b;
+}
+
+void eventLogInit();
+uint32_t eventLogGetCount();
+void eventLogDump();
+
+#endif
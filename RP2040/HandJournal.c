@@ -0,0 +1,137 @@
+#include "pico/stdlib.h"
+
+#include "HandJournal.h"
+#include "Seek.h"
+#include "Storage.h"
+#include "WorkQueue.h"
+
+// Keeps the positions of the clock hands in flash so they survive a power loss and don't need to be homed again.
+// The journal is a ring of records in the last sectors of the flash. Every change appends a record after the newest one,
+// which is the one with the highest sequence number, so nothing is ever overwritten in place. A sector gets erased
+// once the ring comes back around to it, which spreads the erases evenly over all sectors of the journal.
+//
+// The records are written from the work queue, never from the interrupt handlers. Writing the flash holds off
+// the interrupts for one page program (<1ms) per minute and one sector erase (~50ms) every 8.5 hours.
+
+/// @brief Position of the hour hand in a record that marks the hands as not homed.
+#define HAND_JOURNAL_UNKNOWN 0x3f
+
+struct handJournalRecord
+{
+    /// @brief Counts up with every record. 0xffffffff in an erased slot.
+    uint32_t sequence;
+
+    /// @brief seekGetHandState in the low bits, a check of the whole record in the bits above.
+    /// Tells a record that got cut short by a power loss from a complete one.
+    uint32_t hands;
+};
+
+#define HAND_JOURNAL_RECORDS_PER_SECTOR (FLASH_SECTOR_SIZE / sizeof(struct handJournalRecord))
+#define HAND_JOURNAL_RECORDS (STORAGE_JOURNAL_SECTORS * HAND_JOURNAL_RECORDS_PER_SECTOR)
+
+#define HAND_JOURNAL_STATE_MASK ((1u << SEEK_HAND_STATE_BITS) - 1)
+
+/// @brief The journal read through XIP, set up by handJournalRestore.
+static const struct handJournalRecord *records;
+
+/// @brief Slot the next record goes to and its sequence number.
+static uint32_t nextSlot = 0;
+static uint32_t nextSequence = 0;
+
+/// @brief State in the newest record.
+static uint32_t writtenState = HAND_JOURNAL_UNKNOWN;
+
+/// @brief State the work item writes, taken when the hands moved.
+static volatile uint32_t pendingState;
+
+static uint32_t check(uint32_t sequence, uint32_t state)
+{
+    // Salted so a record of zeros (sequence 0, all hands at 12) doesn't pass
+    return ((sequence ^ state ^ 0x5a5a5a5au) * 0x9e3779b1u) >> SEEK_HAND_STATE_BITS;
+}
+
+static bool isValid(const struct handJournalRecord *record)
+{
+    return record->sequence != 0xffffffff &&
+           record->hands >> SEEK_HAND_STATE_BITS == check(record->sequence, record->hands & HAND_JOURNAL_STATE_MASK);
+}
+
+static bool isErased(const struct handJournalRecord *record)
+{
+    return record->sequence == 0xffffffff && record->hands == 0xffffffff;
+}
+
+/// @brief Writes a record into the next free slot, erasing the sector first when the ring got back to it.
+static void appendRecord(uint32_t state)
+{
+    // Slots of records that got cut short can't be written again
+    while (!isErased(&records[nextSlot]) && nextSlot % HAND_JOURNAL_RECORDS_PER_SECTOR != 0)
+        nextSlot = (nextSlot + 1) % HAND_JOURNAL_RECORDS;
+
+    uint32_t offset = STORAGE_JOURNAL_OFFSET + nextSlot * sizeof(struct handJournalRecord);
+    struct handJournalRecord record = {nextSequence, state | (check(nextSequence, state) << SEEK_HAND_STATE_BITS)};
+
+    if (nextSlot % HAND_JOURNAL_RECORDS_PER_SECTOR == 0)
+        storageErase(offset, FLASH_SECTOR_SIZE);
+    storageProgram(offset, &record, sizeof(record));
+
+    nextSlot = (nextSlot + 1) % HAND_JOURNAL_RECORDS;
+    nextSequence++;
+    writtenState = state;
+}
+
+/// @brief Writes the state the hands were in when the work got posted.
+static void handJournalWork(struct workItem *item)
+{
+    uint32_t state = pendingState;
+
+    if (state != writtenState)
+        appendRecord(state);
+}
+
+static struct workItem journalWork = WORK_ITEM_INIT(handJournalWork);
+
+/// @brief Finds the newest record and sets up the steppers with the positions it holds.
+/// Needs to be called before the steppers get initialized, so their coils get energized where the rotors are.
+/// @return false when the journal is empty or the hands weren't homed when the newest record was written.
+bool handJournalRestore()
+{
+    records = storageRead(STORAGE_JOURNAL_OFFSET);
+
+    const struct handJournalRecord *newest = NULL;
+    for (uint32_t slot = 0; slot < HAND_JOURNAL_RECORDS; slot++)
+    {
+        if (isValid(&records[slot]) && (newest == NULL || records[slot].sequence > newest->sequence))
+        {
+            newest = &records[slot];
+            nextSlot = (slot + 1) % HAND_JOURNAL_RECORDS;
+        }
+    }
+
+    if (newest == NULL)
+        return false;
+
+    nextSequence = newest->sequence + 1;
+    writtenState = newest->hands & HAND_JOURNAL_STATE_MASK;
+    pendingState = writtenState;
+
+    return seekRestoreHandState(writtenState);
+}
+
+/// @brief Records where the hands are now. The flash gets written from the work queue.
+/// Can be called from interrupt handlers.
+void handJournalSave()
+{
+    pendingState = seekGetHandState();
+    workQueuePost(&journalWork);
+}
+
+/// @brief Records that the positions of the hands aren't known until the next save, for when they get homed or seek.
+/// Writes the flash right away so the record is there before the hands move. Called from thread mode.
+void handJournalInvalidate()
+{
+    pendingState = HAND_JOURNAL_UNKNOWN;
+
+    if (writtenState != HAND_JOURNAL_UNKNOWN)
+        appendRecord(HAND_JOURNAL_UNKNOWN);
+}
@@ -0,0 +1,10 @@
+#ifndef HAND_JOURNAL_H
+#define HAND_JOURNAL_H
+
+#include "pico/types.h"
+
+bool handJournalRestore();
+void handJournalSave();
+void handJournalInvalidate();
+
+#endif
@@ -0,0 +1,291 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Sets the clock to the time of this computer over the usb serial console, to a few milliseconds.
+//
+// The rtc of the clock only counts whole seconds, so instead of sending the time the tool finds out how the
+// 1MHz timer of the clock relates to its own clock and has the clock start the rtc on the timer at the start
+// of a second. It sends SYNC a few times and notes when each one went out (t1) and when the reply came back (t4),
+// the reply holds the timer when the line came in (t2) and when the reply went out (t3). Like NTP the timer is
+// ((t2 - t1) + (t3 - t4)) / 2 ahead of the clock here, off by at most half the round trip minus the time the clock
+// took to reply, so the sample with the shortest round trip is the one that gets used. Then SYNC TIME starts
+// the rtc at the next second that is far enough ahead for the command to get there. The time goes out as unix time,
+// the rtc runs in UTC and the hands show the time of the zone configured on the clock (SET ZONE).
+//
+//   ./ClockSync /dev/ttyACM0
+//   ./ClockSync --zone Europe/Berlin /dev/ttyACM0     sets the zone of the clock as well
+//   ./ClockSync --interval 3600 /dev/ttyACM0          keeps it in sync, once an hour
+
+/// @brief How long to wait for a reply in ms. SYNC TIME only replies once the hands have been moved.
+#define REPLY_TIMEOUT_MS 2000
+#define SEEK_TIMEOUT_MS 120000
+
+struct syncSample
+{
+    /// @brief Host time in us (UTC, like the rtc of the clock) when SYNC went out and when the reply came in.
+    int64_t sent;
+    int64_t received;
+
+    /// @brief Timer of the clock when SYNC came in and when the reply went out.
+    int64_t clockReceived;
+    int64_t clockSent;
+};
+
+/// @brief Time of the host in us since 1970 (UTC), the time the rtc of the clock is supposed to have.
+static int64_t hostTimeUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int openConsole(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    // Raw, the console isn't a terminal
+    struct termios attributes;
+    if (tcgetattr(fd, &attributes) == 0)
+    {
+        cfmakeraw(&attributes);
+        tcsetattr(fd, TCSANOW, &attributes);
+    }
+
+    return fd;
+}
+
+/// @brief Reads a line without the line end.
+/// @return false when no complete line came in within the timeout.
+static bool readLine(int fd, char *line, size_t size, int timeoutMs)
+{
+    size_t length = 0;
+
+    while (true)
+    {
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, timeoutMs) <= 0)
+            return false;
+
+        char c;
+        if (read(fd, &c, 1) != 1)
+            return false;
+
+        if (c == '\n')
+        {
+            line[length] = '\0';
+            return true;
+        }
+
+        if (c != '\r' && length < size - 1)
+            line[length++] = c;
+    }
+}
+
+/// @brief Sends a command and reads lines until the one with OK or ERR.
+static bool command(int fd, const char *text, char *reply, size_t size, int timeoutMs)
+{
+    size_t length = strlen(text);
+    if (write(fd, text, length) != (ssize_t)length)
+        return false;
+
+    while (readLine(fd, reply, size, timeoutMs))
+        if (strncmp(reply, "OK", 2) == 0 || strncmp(reply, "ERR", 3) == 0)
+            return true;
+
+    return false;
+}
+
+static bool takeSample(int fd, struct syncSample *sample)
+{
+    char reply[128];
+    long long clockReceived;
+    long long clockSent;
+
+    sample->sent = hostTimeUs();
+    if (!command(fd, "SYNC\n", reply, sizeof(reply), REPLY_TIMEOUT_MS))
+        return false;
+    sample->received = hostTimeUs();
+
+    if (sscanf(reply, "OK rx=%lld tx=%lld", &clockReceived, &clockSent) != 2)
+    {
+        fprintf(stderr, "Unexpected reply to SYNC: %s\n", reply);
+        return false;
+    }
+
+    sample->clockReceived = clockReceived;
+    sample->clockSent = clockSent;
+    return true;
+}
+
+static int64_t roundTrip(const struct syncSample *sample)
+{
+    return (sample->received - sample->sent) - (sample->clockSent - sample->clockReceived);
+}
+
+/// @brief How far the timer of the clock is ahead of the time of the host in us.
+static int64_t offset(const struct syncSample *sample)
+{
+    return ((sample->clockReceived - sample->sent) + (sample->clockSent - sample->received)) / 2;
+}
+
+/// @brief Runs one sync.
+/// @param samples How many SYNCs to send, the one with the shortest round trip gets used.
+/// @param marginUs How far ahead of now the second the rtc starts at has to be at least.
+static bool syncClock(int fd, uint32_t samples, int64_t marginUs)
+{
+    // Whatever the clock printed before, like the replies to the setup, isn't of interest
+    tcflush(fd, TCIFLUSH);
+
+    struct syncSample best;
+    bool haveSample = false;
+
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        struct syncSample sample;
+        if (!takeSample(fd, &sample))
+            continue;
+
+        if (!haveSample || roundTrip(&sample) < roundTrip(&best))
+            best = sample;
+        haveSample = true;
+    }
+
+    if (!haveSample)
+    {
+        fprintf(stderr, "The clock didn't reply to SYNC\n");
+        return false;
+    }
+
+    // The next whole second that is far enough ahead, on the timer of the clock
+    int64_t startSecond = (hostTimeUs() + marginUs) / 1000000 + 1;
+    int64_t startTimer = startSecond * 1000000 + offset(&best);
+
+    char text[64];
+    char reply[128];
+    snprintf(text, sizeof(text), "SYNC TIME %lld %lld\n", (long long)startSecond, (long long)startTimer);
+
+    if (!command(fd, text, reply, sizeof(reply), SEEK_TIMEOUT_MS))
+    {
+        fprintf(stderr, "The clock didn't reply to SYNC TIME\n");
+        return false;
+    }
+
+    if (strcmp(reply, "OK") != 0)
+    {
+        fprintf(stderr, "SYNC TIME failed: %s\n", reply);
+        return false;
+    }
+
+    time_t start = startSecond;
+    struct tm t;
+    char shown[32];
+    gmtime_r(&start, &t);
+    strftime(shown, sizeof(shown), "%Y-%m-%dT%H:%M:%S", &t);
+
+    printf("Clock started at %s UTC, round trip %.3fms, off by at most %.3fms\n",
+           shown, roundTrip(&best) / 1e3, roundTrip(&best) / 2e3);
+    fflush(stdout);
+    return true;
+}
+
+/// @brief Sets the zone the hands show the time of, the clock keeps it in flash.
+static bool setZone(int fd, const char *zone)
+{
+    char text[80];
+    char reply[128] = "no reply";
+    snprintf(text, sizeof(text), "SET ZONE %s\n", zone);
+
+    tcflush(fd, TCIFLUSH);
+    if (!command(fd, text, reply, sizeof(reply), SEEK_TIMEOUT_MS) || strcmp(reply, "OK") != 0)
+    {
+        fprintf(stderr, "SET ZONE %s failed: %s\n", zone, reply);
+        return false;
+    }
+
+    return true;
+}
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] DEVICE\n"
+            "  --samples N        SYNCs per sync, the one with the shortest round trip gets used (default 8)\n"
+            "  --margin MS        How far ahead the rtc gets started at least (default 100)\n"
+            "  --interval SECONDS Keep running and sync again after the given time\n"
+            "  --zone NAME        Set the time zone of the clock first (tz database name like Europe/Berlin)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    uint32_t samples = 8;
+    int64_t marginUs = 100000;
+    uint32_t interval = 0;
+    const char *zone = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--samples") == 0 && hasValue)
+            samples = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--margin") == 0 && hasValue)
+            marginUs = strtoll(argv[++i], NULL, 10) * 1000;
+        else if (strcmp(argv[i], "--interval") == 0 && hasValue)
+            interval = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--zone") == 0 && hasValue)
+            zone = argv[++i];
+        else if (argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (path == NULL || samples == 0)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    int fd = openConsole(path);
+    if (fd < 0)
+        return 1;
+
+    if (zone != NULL && !setZone(fd, zone))
+    {
+        close(fd);
+        return 1;
+    }
+
+    bool synced = syncClock(fd, samples, marginUs);
+
+    // A failed sync gets tried again at the next interval, the clock might just have been unplugged
+    while (interval > 0)
+    {
+        sleep(interval);
+        syncClock(fd, samples, marginUs);
+    }
+
+    close(fd);
+    return synced ? 0 : 1;
+}
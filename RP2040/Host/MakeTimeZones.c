@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Generates TimeZones.c, the transition tables of the time zones the clock knows, from the tz database of this computer.
+// For every year of the tables it looks for the quarter hours (of UTC) at which the offset of the zone changes, the
+// firmware then only needs the year and the quarter hour of the year to find the offset. The tables only fit zones
+// that change twice a year between the same two offsets (daylight saving time) or never, anything else gets rejected.
+// UTC always comes first, it is what a clock without a configured zone uses.
+//
+//   ./MakeTimeZones Europe/Berlin America/New_York > ../TimeZones.c
+//
+// The zones are looked up by index in the settings of the clock, new ones need to go at the end.
+
+#define ZONEINFO "/usr/share/zoneinfo"
+
+/// @brief Range and resolution of the tables, the generated file checks that TimeZone.h agrees.
+#define TIME_ZONE_FIRST_YEAR 2020
+#define TIME_ZONE_YEARS 80
+#define TIME_ZONE_QUARTER_HOUR 900
+
+/// @brief The offset of the current TZ at the given time in minutes.
+static int32_t offsetAt(time_t time)
+{
+    struct tm local;
+    localtime_r(&time, &local);
+    return local.tm_gmtoff / 60;
+}
+
+static time_t yearStart(int32_t year)
+{
+    struct tm t = {0};
+    t.tm_year = year - 1900;
+    t.tm_mday = 1;
+    return timegm(&t);
+}
+
+/// @brief The name as a C identifier, Europe/Berlin becomes europeBerlin.
+static void identifier(const char *name, char *result, size_t size)
+{
+    size_t length = 0;
+    bool upper = false;
+
+    for (; *name != '\0' && length < size - 1; name++)
+    {
+        char c = *name;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        {
+            if (length == 0 && c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            else if (upper && c >= 'a' && c <= 'z')
+                c -= 'a' - 'A';
+
+            result[length++] = c;
+            upper = false;
+        }
+        else
+            upper = true;
+    }
+
+    result[length] = '\0';
+}
+
+/// @brief Looks up the transitions of a zone and checks that they fit the tables.
+/// @param offsets Gets the offset at the start of the years and after the first transition.
+/// @param transitions Gets the quarter hours of the two transitions of each year.
+/// @return The number of transitions per year (0 or 2), -1 when the zone doesn't fit.
+static int32_t readZone(const char *name, int32_t offsets[2], uint16_t transitions[TIME_ZONE_YEARS][2])
+{
+    // An unknown TZ is taken as UTC by the C library without saying so
+    char path[256];
+    snprintf(path, sizeof(path), ZONEINFO "/%s", name);
+    if (strcmp(name, "UTC") != 0 && access(path, R_OK) != 0)
+    {
+        fprintf(stderr, "%s: not in " ZONEINFO "\n", name);
+        return -1;
+    }
+
+    setenv("TZ", name, 1);
+    tzset();
+
+    offsets[0] = offsetAt(yearStart(TIME_ZONE_FIRST_YEAR));
+    offsets[1] = offsets[0];
+    int32_t perYear = -1;
+
+    for (int32_t i = 0; i < TIME_ZONE_YEARS; i++)
+    {
+        int32_t year = TIME_ZONE_FIRST_YEAR + i;
+        time_t start = yearStart(year);
+        time_t end = yearStart(year + 1);
+        int32_t count = 0;
+        int32_t offset = offsetAt(start);
+
+        if (offset != offsets[0])
+        {
+            fprintf(stderr, "%s: %d starts at %+d minutes instead of %+d\n", name, year, offset, offsets[0]);
+            return -1;
+        }
+
+        for (time_t t = start + TIME_ZONE_QUARTER_HOUR; t < end; t += TIME_ZONE_QUARTER_HOUR)
+        {
+            int32_t next = offsetAt(t);
+            if (next == offset)
+                continue;
+
+            if (offsetAt(t - 1) != offset || count == 2)
+            {
+                fprintf(stderr, "%s: the offset changes in %d in a way the table can't hold\n", name, year);
+                return -1;
+            }
+
+            if (count == 0 && offsets[1] == offsets[0])
+                offsets[1] = next;
+
+            if (next != offsets[count == 0 ? 1 : 0])
+            {
+                fprintf(stderr, "%s: %d changes to %+d minutes, not between %+d and %+d\n", name, year, next, offsets[0], offsets[1]);
+                return -1;
+            }
+
+            transitions[i][count++] = (t - start) / TIME_ZONE_QUARTER_HOUR;
+            offset = next;
+        }
+
+        if (perYear >= 0 && count != perYear)
+        {
+            fprintf(stderr, "%s: %d has %d transitions, the years before %d\n", name, year, count, perYear);
+            return -1;
+        }
+
+        perYear = count;
+    }
+
+    if (perYear == 1)
+    {
+        fprintf(stderr, "%s: changes only once a year\n", name);
+        return -1;
+    }
+
+    return perYear;
+}
+
+/// @brief The version of the tz database, from the first line of tzdata.zi.
+static void databaseVersion(char *version, size_t size)
+{
+    snprintf(version, size, "unknown");
+
+    FILE *file = fopen(ZONEINFO "/tzdata.zi", "r");
+    if (file == NULL)
+        return;
+
+    char line[64];
+    if (fgets(line, sizeof(line), file) != NULL && strncmp(line, "# version ", 10) == 0)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        snprintf(version, size, "%s", line + 10);
+    }
+
+    fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s ZONE... > TimeZones.c\n", argv[0]);
+        return 2;
+    }
+
+    const char **names = malloc(argc * sizeof(char *));
+    int32_t count = 0;
+    names[count++] = "UTC";
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "UTC") != 0)
+            names[count++] = argv[i];
+
+    static int32_t offsets[256][2];
+    static uint16_t transitions[256][TIME_ZONE_YEARS][2];
+    static int32_t perYear[256];
+    if (count > 256)
+    {
+        fprintf(stderr, "Too many zones\n");
+        return 2;
+    }
+
+    for (int32_t i = 0; i < count; i++)
+        if ((perYear[i] = readZone(names[i], offsets[i], transitions[i])) < 0)
+            return 1;
+
+    char version[32];
+    databaseVersion(version, sizeof(version));
+
+    printf("#include \"pico.h\"\n\n#include \"TimeZone.h\"\n\n");
+    printf("// Generated by Host/MakeTimeZones.c from the tz database %s, don't edit.\n", version);
+    printf("// Transitions in quarter hours of UTC since the start of the years %d to %d.\n\n",
+           TIME_ZONE_FIRST_YEAR, TIME_ZONE_FIRST_YEAR + TIME_ZONE_YEARS - 1);
+    printf("#if TIME_ZONE_FIRST_YEAR != %d || TIME_ZONE_YEARS != %d || TIME_ZONE_QUARTER_HOUR != %d\n",
+           TIME_ZONE_FIRST_YEAR, TIME_ZONE_YEARS, TIME_ZONE_QUARTER_HOUR);
+    printf("#error The tables need to be generated again for the range of TimeZone.h\n#endif\n");
+
+    for (int32_t i = 0; i < count; i++)
+    {
+        if (perYear[i] == 0)
+            continue;
+
+        char name[64];
+        identifier(names[i], name, sizeof(name));
+        printf("\nstatic const uint16_t %s[TIME_ZONE_YEARS][2] = {", name);
+
+        for (int32_t year = 0; year < TIME_ZONE_YEARS; year++)
+            printf("%s{%u, %u},", year % 6 == 0 ? "\n    " : " ", transitions[i][year][0], transitions[i][year][1]);
+
+        printf("\n};\n");
+    }
+
+    printf("\nconst struct timeZone timeZones[] = {\n");
+    for (int32_t i = 0; i < count; i++)
+    {
+        char name[64];
+        identifier(names[i], name, sizeof(name));
+        printf("    {\"%s\", {%d, %d}, %s},\n", names[i], offsets[i][0], offsets[i][1], perYear[i] != 0 ? name : "NULL");
+    }
+    printf("};\n\nconst uint32_t timeZoneCount = count_of(timeZones);\n");
+
+    return 0;
+}
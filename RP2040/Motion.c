@@ -0,0 +1,220 @@
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "Motion.h"
+#include "Power.h"
+#include "Stepper.h"
+#include "WarmStart.h"
+#include "WorkQueue.h"
+
+/// @brief Integer square root.
+static uint32_t squareRoot(uint32_t value)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+            result >>= 1;
+
+        bit >>= 2;
+    }
+
+    return result;
+}
+
+/// @brief Step rate the motor can reach after the given number of steps when accelerating from the start rate.
+/// v^2 = v0^2 + 2 * a * n
+/// The profile is in full steps, rate and steps are in microsteps of which there are the given number per full step.
+static uint32_t rateAfterSteps(const struct motionProfile *profile, uint32_t microsteps, uint32_t steps)
+{
+    uint32_t startRate = profile->startRate * microsteps;
+    return squareRoot((startRate * startRate) + (2 * profile->acceleration * microsteps * steps));
+}
+
+/// @brief Time until the next step of the move in us.
+/// Accelerates from the start of the move and decelerates towards its end, whichever gives the lower rate, limited to the max rate.
+/// Short moves never reach the max rate and get a triangular profile.
+static uint32_t nextStepInterval(struct motion *motion)
+{
+    const struct motionProfile *profile = motion->profile;
+    uint32_t microsteps = stepperGetMicrosteps(motion->stepper);
+
+    uint32_t rate = rateAfterSteps(profile, microsteps, motion->stepsTaken);
+
+    uint32_t brakingRate = rateAfterSteps(profile, microsteps, motion->stepsRemaining - 1);
+    if (brakingRate < rate)
+        rate = brakingRate;
+
+    if (rate > profile->maxRate * microsteps)
+        rate = profile->maxRate * microsteps;
+
+    return 1000000 / rate;
+}
+
+/// @brief Time of the earliest step that any motion of the group still has to take or UINT64_MAX when all are done.
+static uint64_t earliestStepTime(struct motionGroup *group)
+{
+    uint64_t earliest = UINT64_MAX;
+
+    for (uint32_t i = 0; i < group->motionCount; i++)
+    {
+        struct motion *motion = group->motions[i];
+        if (motion->stepsRemaining > 0 && motion->nextStepTime < earliest)
+            earliest = motion->nextStepTime;
+    }
+
+    return earliest;
+}
+
+/// @brief Schedules the group at the earliest step that any of its motions still has to take.
+static void scheduleNextStep(struct motionGroup *group)
+{
+    uint64_t earliest = earliestStepTime(group);
+
+    if (earliest != UINT64_MAX)
+        schedulerAdd(&group->stepEvent, earliest);
+}
+
+/// @brief Stages the steps of all motions that are due at the given time and works out when their next steps are due.
+static void stageDueSteps(struct motionGroup *group, uint64_t time, struct stepperGroup *stepperGroup)
+{
+    for (uint32_t i = 0; i < group->motionCount; i++)
+    {
+        struct motion *motion = group->motions[i];
+        if (motion->stepsRemaining == 0 || motion->nextStepTime > time)
+            continue;
+
+        stepperGroupStageMicrostep(stepperGroup, motion->stepper, motion->forward);
+        motion->stepsTaken++;
+        motion->stepsRemaining--;
+
+        if (motion->stepsRemaining > 0)
+            motion->nextStepTime += nextStepInterval(motion);
+    }
+}
+
+/// @brief Takes all steps that are due and schedules the next ones.
+static void motionStepHandler(struct schedulerEvent *event)
+{
+    struct motionGroup *group = (struct motionGroup *)((uint8_t *)event - offsetof(struct motionGroup, stepEvent));
+    struct stepperGroup stepperGroup = STEPPER_GROUP_INIT;
+
+    stageDueSteps(group, event->time, &stepperGroup);
+    stepperGroupCommit(&stepperGroup);
+
+    scheduleNextStep(group);
+}
+
+/// @brief Times the first step of every motion of the group from the given start time.
+static void startMotions(struct motionGroup *group, uint64_t startTime)
+{
+    for (uint32_t i = 0; i < group->motionCount; i++)
+    {
+        struct motion *motion = group->motions[i];
+        if (motion->stepsRemaining > 0)
+            motion->nextStepTime = startTime + nextStepInterval(motion);
+    }
+}
+
+/// @brief Sets up the move of a motor. The move starts with motionGroupStart.
+/// @param motion The motor and its profile.
+/// @param steps Number of full steps to move.
+/// @param forward The direction to move the stepper motor.
+void motionPrepare(struct motion *motion, uint32_t steps, bool forward)
+{
+    motion->forward = forward;
+    motion->stepsTaken = 0;
+    motion->stepsRemaining = steps * stepperGetMicrosteps(motion->stepper);
+}
+
+/// @brief Starts the prepared moves of all motors of the group at the same time. Moves that are still active get replaced.
+/// @param group The motors to move.
+void motionGroupStart(struct motionGroup *group)
+{
+    schedulerRemove(&group->stepEvent);
+    group->stepEvent.callback = motionStepHandler;
+
+    startMotions(group, time_us_64());
+
+    scheduleNextStep(group);
+}
+
+/// @brief Starts the prepared moves of all motors of the group and sleeps until the last step has been taken.
+/// @param group The motors to move.
+void motionGroupRun(struct motionGroup *group)
+{
+    powerRequest(POWER_STATE_STEPPING);
+    motionGroupStart(group);
+
+    // With interrupts disabled the timer irq of the last step still wakes the core if it happens before the wfi
+    while (true)
+    {
+        workQueueRun();
+
+        uint32_t status = save_and_disable_interrupts();
+        bool done = !motionGroupIsActive(group);
+        if (!done && workQueueIsEmpty())
+            warmStartWaitForInterrupt();
+        restore_interrupts(status);
+
+        if (done)
+            break;
+    }
+
+    powerRelease(POWER_STATE_STEPPING);
+}
+
+/// @brief Indicates whether any motor of the group still has steps to take.
+bool motionGroupIsActive(struct motionGroup *group)
+{
+    for (uint32_t i = 0; i < group->motionCount; i++)
+        if (group->motions[i]->stepsRemaining > 0)
+            return true;
+
+    return false;
+}
+
+/// @brief Works out all steps of the prepared moves of the group up front instead of taking them from the timer interrupt.
+/// The steppers are advanced to the end of the moves right away, the steps still have to be output by the caller.
+/// Only wave drive can be planned, staging a microstep sets its pwm duty right away.
+/// @param group The motors to move.
+/// @param plan Receives one entry for every point in time at which at least one motor steps.
+/// @param capacity Number of entries the plan has room for.
+/// @return Number of entries written to the plan.
+uint32_t motionGroupPlan(struct motionGroup *group, struct motionPlanStep *plan, uint32_t capacity)
+{
+    uint32_t length = 0;
+    uint64_t previousTime = 0;
+
+    for (uint32_t i = 0; i < group->motionCount; i++)
+        if (stepperGetMicrosteps(group->motions[i]->stepper) != 1)
+            panic("Microstepping motors can't be planned");
+
+    startMotions(group, 0);
+
+    uint64_t time;
+    while ((time = earliestStepTime(group)) != UINT64_MAX)
+    {
+        if (length == capacity)
+            panic("Motion plan is full");
+
+        struct motionPlanStep *step = &plan[length++];
+        step->interval = time - previousTime;
+        step->steps = (struct stepperGroup)STEPPER_GROUP_INIT;
+        stageDueSteps(group, time, &step->steps);
+
+        previousTime = time;
+    }
+
+    return length;
+}
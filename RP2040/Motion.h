@@ -0,0 +1,72 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include "pico/types.h"
+
+#include "Scheduler.h"
+#include "Stepper.h"
+
+/// @brief Limits for moving a stepper motor over several steps.
+struct motionProfile
+{
+    /// @brief Step rate the motor starts from and stops at in steps per second.
+    /// The motor has to be able to follow an instant jump to this rate.
+    uint32_t startRate;
+
+    /// @brief Step rate the motor cruises at in steps per second.
+    uint32_t maxRate;
+
+    /// @brief Change of the step rate in steps per second squared.
+    uint32_t acceleration;
+};
+
+/// @brief A move of one stepper motor that accelerates, cruises and decelerates.
+struct motion
+{
+    struct stepper *stepper;
+    const struct motionProfile *profile;
+
+    /// @brief Direction passed to stepperStep.
+    bool forward;
+
+    /// @brief Steps of the move that haven't been taken yet. Microsteps when the stepper is microstepping.
+    volatile uint32_t stepsRemaining;
+
+    /// @brief Steps of the move that have been taken already.
+    uint32_t stepsTaken;
+
+    /// @brief Time (time_us_64) at which the next step is due.
+    uint64_t nextStepTime;
+};
+
+#define MOTION_INIT(stepper, profile) {(stepper), (profile), false, 0, 0, 0}
+
+/// @brief Moves of several stepper motors that run at the same time.
+/// All steps that are due at the same time are output with a single gpio write.
+struct motionGroup
+{
+    struct motion *const *motions;
+    uint32_t motionCount;
+
+    struct schedulerEvent stepEvent;
+};
+
+#define MOTION_GROUP_INIT(motions) {(motions), count_of(motions), SCHEDULER_EVENT_INIT(NULL)}
+
+/// @brief Steps of a planned move that are output together.
+struct motionPlanStep
+{
+    /// @brief Time since the previous entry of the plan (or since the start of the move) in us.
+    uint32_t interval;
+
+    /// @brief Steps of all motors that are due at this point in time.
+    struct stepperGroup steps;
+};
+
+void motionPrepare(struct motion *motion, uint32_t steps, bool forward);
+void motionGroupStart(struct motionGroup *group);
+void motionGroupRun(struct motionGroup *group);
+bool motionGroupIsActive(struct motionGroup *group);
+uint32_t motionGroupPlan(struct motionGroup *group, struct motionPlanStep *plan, uint32_t capacity);
+
+#endif
@@ -0,0 +1,234 @@
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/clocks.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "Power.h"
+#include "WorkQueue.h"
+
+// Gates the clocks of everything the current state doesn't need while both cores sleep. The clocks block
+// only applies sleep_en0/1 in deep sleep, as soon as a core wakes up all clocks run again.
+// On top of that clk_sys runs only as fast as the current state needs. Everything that derives a divider from
+// clk_sys registers a listener and sets it again on every change, the timer and the rtc don't depend on clk_sys.
+
+/// @brief Clocks of the idle state: the rtc for the alarm, the timer with its tick from the watchdog for the
+/// scheduler and the gpio bank so usb power can wake the core.
+#define POWER_IDLE_EN0 (CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS | \
+                        CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS)
+#define POWER_IDLE_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS)
+
+/// @brief The dma reads from sram over the bus fabric.
+#define POWER_DMA_EN0 (CLOCKS_SLEEP_EN0_CLK_SYS_DMA_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS | \
+                       CLOCKS_SLEEP_EN0_CLK_SYS_SRAM0_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_SRAM1_BITS | \
+                       CLOCKS_SLEEP_EN0_CLK_SYS_SRAM2_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_SRAM3_BITS)
+#define POWER_DMA_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_SRAM4_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_SRAM5_BITS)
+
+/// @brief clk_sys straight from the crystal, pll_sys is stopped.
+#define POWER_CRYSTAL_KHZ 12000
+
+/// @brief clk_sys set up by the sdk at boot, usb needs it.
+#define POWER_DEFAULT_KHZ 125000
+
+#if POWER_CLOCK_SCALING
+/// @brief Enough for the pio programs and for core 1 to render a frame well within 20ms.
+#define POWER_BURST_KHZ 48000
+#define POWER_IDLE_KHZ POWER_CRYSTAL_KHZ
+#else
+#define POWER_BURST_KHZ POWER_DEFAULT_KHZ
+#define POWER_IDLE_KHZ POWER_DEFAULT_KHZ
+#endif
+
+static const struct
+{
+    const char *name;
+
+    /// @brief Clocks the state needs on top of the idle ones.
+    uint32_t en0;
+    uint32_t en1;
+
+    /// @brief Frequency of clk_sys in the state.
+    uint32_t sysKhz;
+} powerStates[POWER_STATE_COUNT] = {
+    {"idle", 0, 0, POWER_IDLE_KHZ},
+    {"stepping", POWER_DMA_EN0 | CLOCKS_SLEEP_EN0_CLK_SYS_PIO1_BITS, POWER_DMA_EN1, POWER_BURST_KHZ},
+    {"animating", POWER_DMA_EN0 | CLOCKS_SLEEP_EN0_CLK_SYS_PIO0_BITS, POWER_DMA_EN1, POWER_BURST_KHZ},
+    {"awake", 0xffffffffu, 0xffffffffu, POWER_DEFAULT_KHZ},
+};
+
+/// @brief Number of outstanding requests per state. Idle is always there.
+static uint32_t requests[POWER_STATE_COUNT];
+
+static enum powerState currentState = POWER_STATE_IDLE;
+
+/// @brief Time (time_us_64) at which the current state was entered.
+static uint64_t currentSince = 0;
+
+/// @brief Time spent in each state in us, without the time spent in the current state so far.
+static uint64_t timeInState[POWER_STATE_COUNT];
+
+/// @brief Current frequency of clk_sys in kHz.
+static uint32_t systemKhz = POWER_DEFAULT_KHZ;
+
+/// @brief Everything that needs to know about changes of clk_sys.
+static struct powerClockListener *clockListeners = NULL;
+
+/// @brief Moves clk_sys to the given frequency and lets the listeners set their dividers again.
+static void setSystemClock(uint32_t khz)
+{
+    if (khz == systemKhz)
+        return;
+
+    if (khz == POWER_CRYSTAL_KHZ)
+    {
+        // The switch to clk_ref is glitchless, after that nothing runs from the pll anymore
+        clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, POWER_CRYSTAL_KHZ * KHZ, POWER_CRYSTAL_KHZ * KHZ);
+        pll_deinit(pll_sys);
+    }
+    else
+    {
+        // Runs from clk_ref while pll_sys locks onto the new frequency
+        set_sys_clock_khz(khz, true);
+    }
+
+    systemKhz = khz;
+
+    for (struct powerClockListener *listener = clockListeners; listener != NULL; listener = listener->next)
+        listener->callback(listener, khz * KHZ);
+}
+
+/// @brief Works out the state from the requests and writes the clocks it needs. Called with interrupts disabled.
+/// @param setClock false to only enable the clocks of the state and leave clk_sys to a later call.
+static void powerApply(bool setClock)
+{
+    enum powerState state = POWER_STATE_IDLE;
+    uint32_t en0 = POWER_IDLE_EN0;
+    uint32_t en1 = POWER_IDLE_EN1;
+
+    for (uint32_t i = POWER_STATE_IDLE + 1; i < POWER_STATE_COUNT; i++)
+    {
+        if (requests[i] == 0)
+            continue;
+
+        state = i;
+        en0 |= powerStates[i].en0;
+        en1 |= powerStates[i].en1;
+    }
+
+    // Pwm slices that are running hold the coils of the steppers
+    if (pwm_hw->en != 0)
+        en0 |= CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS;
+
+    clocks_hw->sleep_en0 = en0;
+    clocks_hw->sleep_en1 = en1;
+
+    if (!setClock)
+        return;
+
+    setSystemClock(powerStates[state].sysKhz);
+
+    if (state != currentState)
+    {
+        uint64_t now = time_us_64();
+        timeInState[currentState] += now - currentSince;
+        currentState = state;
+        currentSince = now;
+    }
+}
+
+/// @brief Applies released states and the clk_sys of states requested by handlers in thread mode, moving clk_sys
+/// can take a while for the pll to lock.
+static void powerApplyWork(struct workItem *item)
+{
+    uint32_t status = save_and_disable_interrupts();
+    powerApply(true);
+    restore_interrupts(status);
+}
+
+static struct workItem applyWork = WORK_ITEM_INIT(powerApplyWork);
+
+/// @brief Starts in the awake state (everything clocked, like after reset) and enables deep sleep on core 0,
+/// core 1 enables it for itself, from then on the clocks get gated whenever both cores sleep.
+void powerInit()
+{
+    requests[POWER_STATE_AWAKE] = 1;
+    currentState = POWER_STATE_AWAKE;
+    currentSince = time_us_64();
+
+    uint32_t status = save_and_disable_interrupts();
+    powerApply(true);
+    restore_interrupts(status);
+
+    scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+}
+
+/// @brief Adds something that derives a divider from clk_sys. The callback gets called on every change of clk_sys from now on.
+/// @param listener The listener to add, it has to stay around.
+void powerAddClockListener(struct powerClockListener *listener)
+{
+    uint32_t status = save_and_disable_interrupts();
+    listener->next = clockListeners;
+    clockListeners = listener;
+    restore_interrupts(status);
+}
+
+/// @brief Keeps the clocks of the given state running until it is released again. Requests are counted.
+/// Can be called from interrupt handlers. The clocks of the state run right away, clk_sys gets raised right away
+/// in thread mode only. A handler doesn't wait for the pll to lock, it leaves that to the work queue.
+/// @param state The state that is needed.
+void powerRequest(enum powerState state)
+{
+    bool inHandler = __get_current_exception() != 0;
+
+    uint32_t status = save_and_disable_interrupts();
+    requests[state]++;
+    powerApply(!inHandler);
+    restore_interrupts(status);
+
+    if (inHandler)
+        workQueuePost(&applyWork);
+}
+
+/// @brief Releases a request made with powerRequest. The clocks only go down once the work queue runs,
+/// until then they stay on, which is always safe.
+/// Can be called from interrupt handlers.
+/// @param state The state that is no longer needed.
+void powerRelease(enum powerState state)
+{
+    uint32_t status = save_and_disable_interrupts();
+    if (requests[state] == 0)
+        panic("Power state %s released more often than requested", powerStates[state].name);
+
+    requests[state]--;
+    restore_interrupts(status);
+
+    workQueuePost(&applyWork);
+}
+
+/// @brief Returns the state the clocks are currently set up for.
+enum powerState powerGetState()
+{
+    return currentState;
+}
+
+/// @brief Returns the total time spent in the given state since powerInit in us.
+/// @param state The state to get the time for.
+uint64_t powerGetTimeInState(enum powerState state)
+{
+    uint32_t status = save_and_disable_interrupts();
+    uint64_t time = timeInState[state];
+    if (state == currentState)
+        time += time_us_64() - currentSince;
+    restore_interrupts(status);
+
+    return time;
+}
+
+/// @brief Returns the name of the given state for reports.
+const char *powerGetStateName(enum powerState state)
+{
+    return powerStates[state].name;
+}
+
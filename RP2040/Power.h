@@ -0,0 +1,55 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "pico/types.h"
+
+/// @brief What the clock is doing, each state needs a different set of clocks while the cores sleep.
+/// Later states need more clocks, the state with the most clocks that is requested wins.
+enum powerState
+{
+    /// @brief Waiting for the next rtc alarm, only the rtc, the timer and the gpio bank are clocked.
+    POWER_STATE_IDLE,
+
+    /// @brief A seek is being played back by the step generator or the scheduler.
+    POWER_STATE_STEPPING,
+
+    /// @brief The leds show a pattern.
+    POWER_STATE_ANIMATING,
+
+    /// @brief Usb power is connected, nothing gets gated.
+    POWER_STATE_AWAKE,
+
+    POWER_STATE_COUNT
+};
+
+/// @brief Runs clk_sys only as fast as the current state needs, from the crystal while idle up to 125MHz while awake.
+#ifndef POWER_CLOCK_SCALING
+#define POWER_CLOCK_SCALING 1
+#endif
+
+struct powerClockListener;
+
+/// @brief Called with interrupts disabled right after clk_sys changed, to set the dividers that derive from it again.
+typedef void (*powerClockCallback)(struct powerClockListener *listener, uint32_t sysHz);
+
+/// @brief Something clocked from clk_sys (pio, pwm, ...). Owned by the caller and kept in a list once added.
+struct powerClockListener
+{
+    /// @brief The function to call.
+    powerClockCallback callback;
+
+    /// @brief Next listener in the list. Leave at NULL.
+    struct powerClockListener *next;
+};
+
+#define POWER_CLOCK_LISTENER_INIT(callback) {(callback), NULL}
+
+void powerInit();
+void powerAddClockListener(struct powerClockListener *listener);
+void powerRequest(enum powerState state);
+void powerRelease(enum powerState state);
+enum powerState powerGetState();
+uint64_t powerGetTimeInState(enum powerState state);
+const char *powerGetStateName(enum powerState state);
+
+#endif
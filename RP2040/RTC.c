@@ -1,39 +1,236 @@
 #include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/stdlib.h"
 
+#include "Config.h"
+#include "DateTimeParser.h"
+#include "EventLog.h"
+#include "HandJournal.h"
 #include "RTC.h"
+#include "Scheduler.h"
+#include "Seek.h"
 #include "Stepper.h"
+#include "TimeZone.h"
+#include "Trace.h"
+#include "WarmStart.h"
+#include "WorkQueue.h"
 #include "WS2812.h"
 
-/// @brief Indicates whether the hourly animations are enabled
-bool enableHourlyAnimation;
+/// @brief Cleared while the rtc runs from the time the hands showed at power up, the date and whether it is am or pm are unknown then.
+/// The rtc runs in UTC once the time is set and in the local time the hands showed until then.
+static bool timeSet = false;
 
-/// @brief The hour that the animations are supposed to start at
-/// 0 to 23 inclusive
-uint8_t animationStartHour;
-
-/// @brief The hour that the animations are supposed to start end
-/// 0 to 23 inclusive
-uint8_t animationEndHour;
+/// @brief Offset from UTC in minutes of the time the hands got moved to last, tells when daylight saving time started or ended.
+static int32_t shownOffset = 0;
 
 void enableRtcAlarm();
 
+/// @brief Set when the hour hand takes a step on the next alarm as well.
+static bool hourStepsNext = false;
+
+/// @brief Set while the alarm moves the hands, see enableRtcAlarm.
+static bool alarmEnabled = false;
+
+/// @brief An alarm this much after the rtc got to the minute counts as late.
+#define RTC_ALARM_LATE_US 50000
+
+/// @brief How the alarms kept up since boot.
+static struct rtcAlarmStatistics alarmStatistics;
+
+/// @brief Wakes the coils of the motors that step on the next alarm from their hold mode.
+static void rtcWakeHandler(struct schedulerEvent *event)
+{
+    stepperWake(&minuteStepper);
+
+    if (hourStepsNext)
+        stepperWake(&hourStepper);
+}
+
+/// @brief Timer event shortly before the next alarm.
+static struct schedulerEvent wakeEvent = SCHEDULER_EVENT_INIT(rtcWakeHandler);
+
+// Drift trim: the rtc runs from a crystal that is a few ppm off, that adds up to minutes a month. Every SYNC TIME
+// tells how far the rtc was off, where the rtc was in its second is known from the timer at the last alarm. Over the
+// time since the sync before that this gives the drift in ppb, which gets averaged into config.rtcTrimPpb.
+// The rtc can only be moved by loading it again, which starts its second over. Right after each alarm the trim that
+// has come together is applied by loading second 1 of the minute a little before (ahead) or after (back) the rtc gets
+// there on its own, once it is at least RTC_TRIM_STEP_NS.
+
+/// @brief Smallest and largest trim applied at an alarm. The largest stays below STEPPER_WAKE_LEAD.
+#define RTC_TRIM_STEP_NS 1000000
+#define RTC_TRIM_MAX_US 10000
+
+/// @brief Drift measurements need syncs at least this far apart, the few ms a sync is off would count too much otherwise.
+#define RTC_DRIFT_MIN_INTERVAL_US (3600ull * 1000000)
+
+/// @brief Measurements beyond this are taken for a clock that was changed on the host, not for drift.
+#define RTC_DRIFT_MAX_PPB 150000
+
+/// @brief After a month worth of syncs a new measurement stops counting less.
+#define RTC_TRIM_MAX_MINUTES (31 * 24 * 60)
+
+/// @brief How far a crystal may be off, for the error estimate while there is no measurement yet.
+#define RTC_CRYSTAL_TOLERANCE_PPB 30000
+
+/// @brief Timer when the rtc got to the minute of the last alarm and that minute, lastAlarmAt is 0 when the rtc got loaded since.
+static uint64_t lastAlarmAt = 0;
+static datetime_t lastAlarmTime;
+
+/// @brief Trim applied after the last alarm in us, the rtc is that much ahead of lastAlarmTime plus the time since.
+static int32_t trimSinceAlarm = 0;
+
+/// @brief Trim that has come together but isn't applied yet in ns.
+static int64_t trimDueNs = 0;
+
+/// @brief Trim the trim event applies in us.
+static int32_t trimPending = 0;
+
+/// @brief Timer at the last SYNC TIME, 0 when there was none since the rtc got loaded otherwise.
+static uint64_t syncedAt = 0;
+
+/// @brief Trim applied since the last sync in us.
+static int64_t trimmedSinceSync = 0;
+
+/// @brief How many ppb the trim has been off at the last measurement, for the error estimate.
+static int32_t residualPpb = RTC_CRYSTAL_TOLERANCE_PPB;
+
+/// @brief Loads second 1 of the minute of the last alarm, while the rtc still shows second 0 (ahead) or already second 1 (back).
+static void rtcTrimHandler(struct schedulerEvent *event)
+{
+    datetime_t t = lastAlarmTime;
+    t.sec = 1;
+    rtc_set_datetime(&t);
+
+    trimSinceAlarm = trimPending;
+    trimmedSinceSync += trimPending;
+    trimDueNs -= (int64_t)trimPending * 1000;
+    eventLogWrite(EVENT_RTC_TRIM, 0, trimPending);
+}
+
+static struct schedulerEvent trimEvent = SCHEDULER_EVENT_INIT(rtcTrimHandler);
+
+/// @brief Hour of the alarm that posted the hourly work.
+static uint8_t alarmHour;
+
+/// @brief Starts the hourly animation in thread mode. Getting the clocks up for the leds takes a while for the pll to lock.
+static void rtcHourlyWork(struct workItem *item)
+{
+    if (config.enableHourlyAnimation && timeSet)
+        if (alarmHour >= config.animationStartHour && alarmHour <= config.animationEndHour)
+            ws2812_start_pattern(config.pattern);
+}
+
+static struct workItem hourlyWork = WORK_ITEM_INIT(rtcHourlyWork);
+
+/// @brief Moves the hands to the time while the clock runs.
+static void rtcCatchUp()
+{
+    // The clock got stopped or set since, that moved the hands already
+    if (!alarmEnabled)
+        return;
+
+    disableRtcAlarm();
+    warmStartInvalidate();
+    handJournalInvalidate();
+    rtcSeekHands();
+}
+
+/// @brief Moves the hands in thread mode when an alarm found them further off than a step.
+static void rtcCatchUpWork(struct workItem *item)
+{
+    rtcCatchUp();
+}
+
+static struct workItem catchUpWork = WORK_ITEM_INIT(rtcCatchUpWork);
+
+/// @brief Returns the offset of the local time from the time of the rtc in minutes.
+static int32_t rtcGetOffset(const datetime_t *t)
+{
+    return timeSet ? timeZoneGetOffset(t) : 0;
+}
+
 /// @brief Moves the clock hands when the rtc irq fires
 void rtcAlarmHandler()
 {
+    // The alarm only matches on whole seconds, there's no exact time to measure the latency against
+    TRACE_ENTER(TRACE_UNKNOWN_TIME);
+
     datetime_t dateTime;
+    uint64_t now = time_us_64();
     rtc_disable_alarm();
     rtc_get_datetime(&dateTime);
 
+    // The hands show the local time
+    datetime_t local;
+    int32_t offset = rtcGetOffset(&dateTime);
+    dateTimeFromSeconds(dateTimeToSeconds(&dateTime) + offset * 60, &local);
+    eventLogWrite(EVENT_RTC_ALARM, local.hour, local.min);
+
+    // An alarm can come late when something kept the irq from being handled, or not at all for a minute or more.
+    // When the rtc got to the minute is known from the last alarm, after the rtc got loaded only to the second.
+    uint64_t minuteAt = now - dateTime.sec * 1000000ull;
+    int64_t minutes = 1;
+
+    if (lastAlarmAt != 0)
+    {
+        minutes = (dateTimeToSeconds(&dateTime) - dateTime.sec - dateTimeToSeconds(&lastAlarmTime)) / 60;
+        uint64_t expectedAt = lastAlarmAt + minutes * 60000000 - trimSinceAlarm;
+
+        if (minutes <= 0)
+        {
+            // The same minute again, the rtc got to it when the last alarm came
+            minuteAt = lastAlarmAt;
+        }
+        else if (expectedAt < now && now - expectedAt >= RTC_ALARM_LATE_US)
+        {
+            // Late, the rtc got to the minute when the last alarm says it should have
+            minuteAt = expectedAt;
+        }
+        else
+        {
+            // On time the drift of the rtc against the timer is all there is to the difference, now is more exact then
+            minuteAt = now;
+        }
+    }
+
+    uint64_t late = now - minuteAt;
+    uint32_t missed = minutes > 1 ? minutes - 1 : 0;
+    if (minutes > 0 && (late >= RTC_ALARM_LATE_US || missed > 0))
+    {
+        alarmStatistics.late += late >= RTC_ALARM_LATE_US;
+        alarmStatistics.maxLateUs = MAX(alarmStatistics.maxLateUs, late);
+        alarmStatistics.missed += missed;
+        eventLogWrite(EVENT_RTC_LATE, MIN(missed, UINT8_MAX), MIN(late / 1000, UINT16_MAX));
+    }
+
+    // The same minute again leaves the trim alone
+    if (minutes > 0)
+    {
+        lastAlarmAt = minuteAt;
+        lastAlarmTime = dateTime;
+        lastAlarmTime.sec = 0;
+        trimSinceAlarm = 0;
+    }
+
+    // The hands get compared to the time instead of just taking the step of the minute, so an alarm that came
+    // twice in a minute doesn't move them and one that came after a missed one doesn't leave them behind.
+    // When daylight saving time starts or ends the hour hand is an hour off, that gets moved by the seek.
+    bool transition = offset != shownOffset;
+    if (transition)
+        eventLogWrite(EVENT_TIME_ZONE, 0, offset);
+    shownOffset = offset;
+
+    uint32_t hourPosition;
+    uint32_t minutePosition;
+    convertTimeToSteps(&local, &hourPosition, &minutePosition);
+    uint32_t hourBehind = (hourPosition + STEPS_PER_REVOLUTION - stepperGetPosition(&hourStepper)) % STEPS_PER_REVOLUTION;
+    uint32_t minuteBehind = (minutePosition + STEPS_PER_REVOLUTION - stepperGetPosition(&minuteStepper)) % STEPS_PER_REVOLUTION;
+
     // The minute hand takes a step every 60 seconds (1 step per minute)
     // 1 hour = 60 steps
     // 1 minute = 1 step
 
-    // Seconds:
-    // 00 01 02 03 04 05 06 07 08 09 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29
-    // ^
-    // 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59
-    stepperStep(&minuteStepper, false);
-
     // The hour hand takes a step every 12 minutes (6 steps per hour)
     // 12 hours = 60 steps
     // 1 hour = 5 steps
@@ -44,17 +241,60 @@ void rtcAlarmHandler()
     // ^                                   ^                                   ^
     // 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59
     //                   ^                                   ^
-    if (dateTime.sec == 0 && ((dateTime.min % 12) == 0))
-        stepperStep(&hourStepper, false);
+    if (hourBehind <= 1 && minuteBehind <= 1)
+    {
+        if (hourBehind != 0 || minuteBehind != 0)
+        {
+            // Both hands that move this minute get output with a single write
+            struct stepperGroup group = STEPPER_GROUP_INIT;
+            if (minuteBehind != 0)
+                stepperGroupStage(&group, &minuteStepper, false);
+            if (hourBehind != 0)
+                stepperGroupStage(&group, &hourStepper, false);
+            stepperGroupCommit(&group);
+
+            // A reset or power loss from here on carries on with the hands where they are now
+            warmStartSave(&dateTime);
+            handJournalSave();
+        }
+    }
+    else
+    {
+        // More steps than the handler should take, the seek does them in thread mode with the alarm off
+        if (!transition)
+            alarmStatistics.catchUps++;
+        workQueuePost(&catchUpWork);
+    }
+
+    // The trim of this minute, moving the rtc ahead brings the next alarm forward as well. After a late alarm
+    // the trim waits for the next one, where the rtc is in its second isn't known well enough.
+    int32_t trim = 0;
+    if (minutes > 0)
+    {
+        trimDueNs += (int64_t)config.rtcTrimPpb * minutes * 60;
+        if (late < RTC_ALARM_LATE_US && (trimDueNs >= RTC_TRIM_STEP_NS || trimDueNs <= -RTC_TRIM_STEP_NS))
+        {
+            trim = MAX(-RTC_TRIM_MAX_US, MIN(RTC_TRIM_MAX_US, trimDueNs / 1000));
+            trimPending = trim;
+            schedulerAdd(&trimEvent, minuteAt + 1000000 - trim);
+        }
+    }
+
+    // The next alarm is a minute after the rtc got to this one
+    hourStepsNext = ((local.min + 1) % 12) == 0;
+    schedulerAdd(&wakeEvent, minuteAt + 60000000 - MAX(trim, 0) - STEPPER_WAKE_LEAD);
 
-    if (dateTime.min == 0 && dateTime.sec == 0)
+    // Everything that isn't about the steps happens after the handler. The hour starts with minute 0, which might
+    // have been missed or caught up with a seek, so it counts when it lies within the minutes since the last alarm.
+    if (minutes > 0 && local.min < minutes)
     {
-        if (enableHourlyAnimation)
-            if (dateTime.hour >= animationStartHour && dateTime.hour <= animationEndHour)
-                ws2812_do_pattern();
+        alarmHour = local.hour;
+        workQueuePost(&hourlyWork);
     }
 
     enableRtcAlarm();
+
+    TRACE_EXIT(TRACE_RTC_ALARM);
 }
 
 /// @brief Enables the alarm of the rtc to wake the pico again on the next full minute
@@ -73,19 +313,201 @@ void enableRtcAlarm()
 
     rtc_set_alarm(&dateTime, rtcAlarmHandler);
     rtc_enable_alarm();
+    alarmEnabled = true;
 }
 
 /// @brief Disables the alarm of the rtc
 void disableRtcAlarm()
 {
     rtc_disable_alarm();
+    alarmEnabled = false;
+
+    // The rtc is about to be loaded or the hands moved, a trim would undo that
+    schedulerRemove(&trimEvent);
 }
 
-/// @brief Initializes the rtc with the given time and sets the first alarm
-/// @param t
-void rtcInit(datetime_t *t)
+/// @brief Starts the rtc at the given time without the alarm, the hands don't move until enableRtcAlarm.
+/// The rtc counts the seconds from the time it gets started.
+/// @param t The time in UTC, the local time when isSet is false.
+/// @param isSet false when only the hour (am or pm unknown) and the minute are right, the hourly animations stay off then.
+void rtcStart(datetime_t *t, bool isSet)
 {
+    schedulerRemove(&trimEvent);
+    alarmEnabled = false;
+    timeSet = isSet;
     rtc_init();
     rtc_set_datetime(t);
+
+    // The hands are at the time or get moved there before the alarm is enabled
+    shownOffset = rtcGetOffset(t);
+
+    // Where the rtc was in its second is lost
+    lastAlarmAt = 0;
+    syncedAt = 0;
+    trimmedSinceSync = 0;
+}
+
+/// @brief The core sleeps while waiting for the rtc to start until this long before, then spins with interrupts off.
+#define RTC_SYNC_SPIN_US 200
+
+/// @brief Wakes the core for the spin, the wait loop of rtcSync does the rest.
+static void rtcSyncHandler(struct schedulerEvent *event)
+{
+}
+
+static struct schedulerEvent syncEvent = SCHEDULER_EVENT_INIT(rtcSyncHandler);
+
+/// @brief The timer at the last alarm tells where the rtc is in its second up to a couple of minutes later.
+#define RTC_SYNC_MAX_ALARM_AGE_US 120000000
+
+/// @brief Starts the rtc at the given time when the timer reaches startAt. How far the rtc was off tells its drift,
+/// which gets learned into config.rtcTrimPpb when the last sync is long enough ago.
+/// @param t The time at startAt.
+/// @param startAt Timer (time_us_64) at which the rtc gets started, at most a few seconds ahead.
+void rtcSync(datetime_t *t, uint64_t startAt)
+{
+    bool measured = lastAlarmAt != 0 && startAt - lastAlarmAt < RTC_SYNC_MAX_ALARM_AGE_US;
+    bool learned = false;
+    uint64_t sinceSync = startAt - syncedAt;
+
+    if (measured)
+    {
+        // How far the rtc is behind at startAt, it was at the start of a minute at the last alarm
+        int64_t offset = (dateTimeToSeconds(t) - dateTimeToSeconds(&lastAlarmTime)) * 1000000 -
+                         (int64_t)(startAt - lastAlarmAt) - trimSinceAlarm;
+
+        if (syncedAt != 0 && sinceSync >= RTC_DRIFT_MIN_INTERVAL_US)
+        {
+            // Without the trim the rtc would have been that much further off
+            int64_t drift = (offset + trimmedSinceSync) * 1000000000 / (int64_t)sinceSync;
+
+            if (drift >= -RTC_DRIFT_MAX_PPB && drift <= RTC_DRIFT_MAX_PPB)
+            {
+                learned = true;
+                uint32_t minutes = sinceSync / 60000000;
+                uint32_t weight = MIN(config.rtcTrimMinutes, RTC_TRIM_MAX_MINUTES);
+                int32_t trim = ((int64_t)config.rtcTrimPpb * weight + drift * minutes) / (weight + minutes);
+
+                residualPpb = drift > trim ? drift - trim : trim - drift;
+                config.rtcTrimPpb = trim;
+                config.rtcTrimMinutes = MIN(weight + minutes, RTC_TRIM_MAX_MINUTES);
+            }
+        }
+
+        eventLogWrite(EVENT_RTC_SYNC, learned, MAX(INT16_MIN, MIN(INT16_MAX, offset / 1000)));
+    }
+
+    // Until shortly before the start the work queue keeps running and the core sleeps in between, like during a seek
+    uint64_t spinAt = startAt - RTC_SYNC_SPIN_US;
+    schedulerAdd(&syncEvent, spinAt);
+    while (true)
+    {
+        workQueueRun();
+
+        uint32_t status = save_and_disable_interrupts();
+        bool due = time_us_64() >= spinAt;
+        if (!due && workQueueIsEmpty())
+            warmStartWaitForInterrupt();
+        restore_interrupts(status);
+
+        if (due)
+            break;
+    }
+
+    uint32_t status = save_and_disable_interrupts();
+    busy_wait_until(from_us_since_boot(startAt));
+    rtcStart(t, true);
+    restore_interrupts(status);
+
+    syncedAt = startAt;
+    trimDueNs = 0;
+}
+
+/// @brief Estimated error of the rtc from how long ago the last sync was and how well the drift is known.
+/// @param error Gets the estimate in us.
+/// @return false when the rtc hasn't been synced with SYNC TIME.
+bool rtcGetEstimatedError(uint64_t *error)
+{
+    if (syncedAt == 0)
+        return false;
+
+    uint32_t ppb = config.rtcTrimMinutes > 0 ? residualPpb : RTC_CRYSTAL_TOLERANCE_PPB;
+    *error = (time_us_64() - syncedAt) * ppb / 1000000000;
+    return true;
+}
+
+/// @brief Moves the hands to the local time, again if the minute changed during the seek, then enables the alarm
+/// and saves where the hands are. The alarm needs to be disabled and the warm start and hand journal invalidated.
+void rtcSeekHands()
+{
+    datetime_t time;
+    datetime_t shown;
+    datetime_t now;
+    do
+    {
+        rtc_get_datetime(&time);
+        shownOffset = rtcGetOffset(&time);
+        dateTimeFromSeconds(dateTimeToSeconds(&time) + shownOffset * 60, &shown);
+        seekClockHands(&shown);
+        rtc_get_datetime(&now);
+    } while (now.min != time.min || now.hour != time.hour);
+
     enableRtcAlarm();
-}
\ No newline at end of file
+    warmStartSave(&time);
+    handJournalSave();
+}
+
+/// @brief Copies how the alarms kept up since boot.
+void rtcGetAlarmStatistics(struct rtcAlarmStatistics *statistics)
+{
+    *statistics = alarmStatistics;
+}
+
+/// @brief Initializes the rtc with the given time and sets the first alarm
+/// @param t
+/// @param isSet See rtcStart.
+void rtcInit(datetime_t *t, bool isSet)
+{
+    rtcStart(t, isSet);
+    enableRtcAlarm();
+}
+
+/// @brief Gets the local time the hands are supposed to show.
+/// @return false when the rtc isn't running.
+bool rtcGetLocalTime(datetime_t *local)
+{
+    datetime_t t;
+    if (!rtc_running() || !rtc_get_datetime(&t))
+        return false;
+
+    dateTimeFromSeconds(dateTimeToSeconds(&t) + rtcGetOffset(&t) * 60, local);
+    return true;
+}
+
+/// @brief The zone changed, moves the hands to its local time unless the clock is stopped or runs from the hands.
+void rtcZoneChanged()
+{
+    if (timeSet)
+        rtcCatchUp();
+}
+
+/// @brief Returns the earliest time the next alarm can come at. Where the rtc is in its second isn't known,
+/// so this can be up to a second early.
+/// @return Timer (time_us_64) of the next alarm or UINT64_MAX while the alarm is disabled.
+uint64_t rtcGetNextAlarmAt()
+{
+    if (!alarmEnabled)
+        return UINT64_MAX;
+
+    datetime_t dateTime;
+    rtc_get_datetime(&dateTime);
+
+    // A trim can bring the alarm forward, a second 59 means it can come any moment
+    return time_us_64() + (59 - dateTime.sec) * 1000000ull - RTC_TRIM_MAX_US;
+}
+
+/// @brief Returns whether the time of the rtc has been set, see rtcInit.
+bool rtcIsTimeSet()
+{
+    return timeSet;
+}
@@ -3,10 +3,30 @@
 
 #include "pico/types.h"
 
-extern bool enableHourlyAnimation;
-extern uint8_t animationStartHour;
-extern uint8_t animationEndHour;
-void rtcInit(datetime_t *t);
+/// @brief How the alarms that move the hands kept up.
+struct rtcAlarmStatistics
+{
+    /// @brief Alarms that came RTC_ALARM_LATE_US or more after the rtc got to the minute and the latest of them in us.
+    uint32_t late;
+    uint64_t maxLateUs;
+
+    /// @brief Minutes that passed without an alarm.
+    uint32_t missed;
+
+    /// @brief Alarms that found the hands further behind than a step and moved them with a seek.
+    uint32_t catchUps;
+};
+
+void rtcStart(datetime_t *t, bool isSet);
+void rtcInit(datetime_t *t, bool isSet);
+uint64_t rtcGetNextAlarmAt();
+void rtcSync(datetime_t *t, uint64_t startAt);
+bool rtcGetEstimatedError(uint64_t *error);
+void rtcSeekHands();
+void rtcGetAlarmStatistics(struct rtcAlarmStatistics *statistics);
+bool rtcGetLocalTime(datetime_t *local);
+void rtcZoneChanged();
+bool rtcIsTimeSet();
 void enableRtcAlarm();
 void disableRtcAlarm();
 
@@ -0,0 +1,166 @@
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "Scheduler.h"
+#include "Trace.h"
+
+// Tickless event scheduler. All timed callbacks of the firmware are kept in a min-heap ordered by their time
+// and a single hardware alarm is always armed for the earliest one, so there is one timer interrupt per event.
+
+/// @brief Maximum number of events that can be scheduled at the same time.
+#define SCHEDULER_CAPACITY 16
+
+static struct schedulerEvent *heap[SCHEDULER_CAPACITY];
+static uint32_t heapSize = 0;
+
+/// @brief The hardware alarm the scheduler runs on.
+static uint alarmNumber;
+
+static void heapSwap(uint32_t a, uint32_t b)
+{
+    struct schedulerEvent *tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+
+    heap[a]->heapIndex = a;
+    heap[b]->heapIndex = b;
+}
+
+static void heapSiftUp(uint32_t index)
+{
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+        if (heap[parent]->time <= heap[index]->time)
+            break;
+
+        heapSwap(parent, index);
+        index = parent;
+    }
+}
+
+static void heapSiftDown(uint32_t index)
+{
+    while (true)
+    {
+        uint32_t smallest = index;
+        uint32_t left = 2 * index + 1;
+        uint32_t right = left + 1;
+
+        if (left < heapSize && heap[left]->time < heap[smallest]->time)
+            smallest = left;
+        if (right < heapSize && heap[right]->time < heap[smallest]->time)
+            smallest = right;
+
+        if (smallest == index)
+            break;
+
+        heapSwap(smallest, index);
+        index = smallest;
+    }
+}
+
+static void heapRemoveAt(uint32_t index)
+{
+    heap[index]->heapIndex = -1;
+    heapSize--;
+
+    if (index == heapSize)
+        return;
+
+    heap[index] = heap[heapSize];
+    heap[index]->heapIndex = index;
+    heapSiftDown(index);
+    heapSiftUp(index);
+}
+
+/// @brief Arms the hardware alarm for the earliest event.
+/// @return false when the earliest event is already due and needs to be run right away.
+static bool armAlarm()
+{
+    if (heapSize == 0)
+    {
+        hardware_alarm_cancel(alarmNumber);
+        return true;
+    }
+
+    // Returns true when the target time has already passed
+    return !hardware_alarm_set_target(alarmNumber, from_us_since_boot(heap[0]->time));
+}
+
+/// @brief Runs the callbacks of all events that are due.
+static void schedulerAlarmHandler(uint alarm)
+{
+    do
+    {
+        while (heapSize > 0 && heap[0]->time <= time_us_64())
+        {
+            struct schedulerEvent *event = heap[0];
+            heapRemoveAt(0);
+
+            TRACE_ENTER(event->time);
+            event->callback(event);
+            TRACE_EXIT(TRACE_TIMER);
+        }
+    } while (!armAlarm());
+}
+
+/// @brief Claims a hardware alarm for the scheduler.
+void schedulerInit()
+{
+    alarmNumber = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarmNumber, schedulerAlarmHandler);
+}
+
+/// @brief Schedules the event at the given time. An event that is already scheduled gets moved to the new time.
+/// Can be called from thread mode and from interrupt handlers.
+/// @param event The event to schedule.
+/// @param time Time (time_us_64) at which the callback of the event gets called.
+void schedulerAdd(struct schedulerEvent *event, uint64_t time)
+{
+    uint32_t status = save_and_disable_interrupts();
+
+    if (event->heapIndex >= 0)
+        heapRemoveAt(event->heapIndex);
+
+    if (heapSize == SCHEDULER_CAPACITY)
+        panic("Scheduler is full");
+
+    event->time = time;
+    event->heapIndex = heapSize;
+    heap[heapSize++] = event;
+    heapSiftUp(event->heapIndex);
+
+    // Only the earliest event needs the alarm to be moved, if it is already due let the irq handler run it
+    if (heap[0] == event && !armAlarm())
+        hardware_alarm_force_irq(alarmNumber);
+
+    restore_interrupts(status);
+}
+
+/// @brief Removes the event from the scheduler if it is scheduled.
+/// @param event The event to remove.
+void schedulerRemove(struct schedulerEvent *event)
+{
+    uint32_t status = save_and_disable_interrupts();
+
+    if (event->heapIndex >= 0)
+    {
+        heapRemoveAt(event->heapIndex);
+
+        if (!armAlarm())
+            hardware_alarm_force_irq(alarmNumber);
+    }
+
+    restore_interrupts(status);
+}
+
+/// @brief Returns the time (time_us_64) of the earliest event or UINT64_MAX when nothing is scheduled.
+uint64_t schedulerGetNextTime()
+{
+    uint32_t status = save_and_disable_interrupts();
+    uint64_t time = heapSize > 0 ? heap[0]->time : UINT64_MAX;
+    restore_interrupts(status);
+
+    return time;
+}
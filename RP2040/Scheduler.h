@@ -0,0 +1,32 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "pico/types.h"
+
+struct schedulerEvent;
+
+/// @brief Called from the timer interrupt once the time of the event has been reached.
+/// The event is no longer scheduled at that point and can be added again from inside the callback.
+typedef void (*schedulerCallback)(struct schedulerEvent *event);
+
+/// @brief A callback at a point in time. Owned by the caller and kept in the scheduler while it is scheduled.
+struct schedulerEvent
+{
+    /// @brief Time (time_us_64) at which the callback gets called.
+    uint64_t time;
+
+    /// @brief The function to call.
+    schedulerCallback callback;
+
+    /// @brief Position in the heap of the scheduler or -1 when not scheduled. Leave at -1.
+    int32_t heapIndex;
+};
+
+#define SCHEDULER_EVENT_INIT(callback) {0, (callback), -1}
+
+void schedulerInit();
+void schedulerAdd(struct schedulerEvent *event, uint64_t time);
+void schedulerRemove(struct schedulerEvent *event);
+uint64_t schedulerGetNextTime();
+
+#endif
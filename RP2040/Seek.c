@@ -0,0 +1,146 @@
+#include "pico/stdlib.h"
+
+#include "EventLog.h"
+#include "Motion.h"
+#include "Seek.h"
+#include "StepGenerator.h"
+#include "Stepper.h"
+
+/// @brief Converts the hour and minute of a datetime to the position of each clock hand.
+/// @param dateTime The time that we want to know the hand positions for
+/// @param hourPosition The position of the hour hand in steps clockwise from 12 o'clock
+/// @param minutePosition The position of the minute hand in steps clockwise from 12 o'clock
+void convertTimeToSteps(datetime_t *dateTime, uint32_t *hourPosition, uint32_t *minutePosition)
+{
+    // Step positions are based on the home position (both hands at 12 o'clock)
+    const uint32_t stepsPerHour = STEPS_PER_REVOLUTION / 12; // 5
+
+    uint32_t hourLimitedTo12HourTime = dateTime->hour % 12;
+    uint32_t minuteOffset = (dateTime->min - (dateTime->min % 12)) / 12;
+
+    *hourPosition = (hourLimitedTo12HourTime * stepsPerHour) + minuteOffset;
+
+    *minutePosition = dateTime->min;
+}
+
+/// @brief Sets up moving a clock hand from its current position to the given position the shorter way round.
+/// @param motion The motion of the motor that drives the hand.
+/// @param stepper The stepper motor that drives the hand.
+/// @param targetPosition The position to move to in steps clockwise from 12 o'clock.
+static void seekShortestPath(struct motion *motion, struct stepper *stepper, uint32_t targetPosition)
+{
+    uint32_t clockwiseSteps = (targetPosition + STEPS_PER_REVOLUTION - stepperGetPosition(stepper)) % STEPS_PER_REVOLUTION;
+
+    // Going clockwise means stepping backwards (see stepperStep)
+    if (clockwiseSteps <= STEPS_PER_REVOLUTION / 2)
+        motionPrepare(motion, clockwiseSteps, false);
+    else
+        motionPrepare(motion, STEPS_PER_REVOLUTION - clockwiseSteps, true);
+}
+
+/// @brief Acceleration profile of both motors when seeking.
+/// The start rate is the old fixed seek rate which the motors are known to follow from standstill.
+const struct motionProfile seekProfile = {
+    50,  // start rate (steps/s)
+    150, // max rate (steps/s)
+    300, // acceleration (steps/s^2)
+};
+
+struct motion hourMotion = MOTION_INIT(&hourStepper, &seekProfile);
+struct motion minuteMotion = MOTION_INIT(&minuteStepper, &seekProfile);
+
+struct motion *const seekMotions[] = {&hourMotion, &minuteMotion};
+struct motionGroup seekGroup = MOTION_GROUP_INIT(seekMotions);
+
+/// @brief Runs the prepared moves of both motors, the core sleeps until both motors took their last step.
+static void runSeekGroup()
+{
+#if STEPPER_MICROSTEPPING
+    // The pwm duty of the coils changes with every microstep, so the steps are timed by the scheduler
+    motionGroupRun(&seekGroup);
+#else
+    // The PIO times the steps
+    stepGeneratorRun(&seekGroup);
+#endif
+
+    eventLogWrite(EVENT_SEEK_END, stepperGetPosition(&hourStepper), stepperGetPosition(&minuteStepper));
+}
+
+/// @brief Moves the clock hands from their current position to the correct position for the given time.
+/// Each hand takes the shorter way round on its own so no hand moves more than half a revolution.
+/// Both clock hands need to have been homed before.
+/// @param dateTime The time that we want to move the clock hands to
+void seekClockHands(datetime_t *dateTime)
+{
+    uint32_t hourPosition;
+    uint32_t minutePosition;
+    convertTimeToSteps(dateTime, &hourPosition, &minutePosition);
+    eventLogWrite(EVENT_SEEK_BEGIN, hourPosition, minutePosition);
+
+    // Both motors move at the same time, each with its own profile
+    seekShortestPath(&minuteMotion, &minuteStepper, minutePosition);
+    seekShortestPath(&hourMotion, &hourStepper, hourPosition);
+
+    runSeekGroup();
+}
+
+/// @brief Moves one clock hand by the given number of steps, the other one stays where it is.
+/// Moves longer than half a revolution are split so the plan of the step generator never holds more than a seek does.
+/// @param stepper hourStepper or minuteStepper.
+/// @param steps Steps clockwise, negative steps go counterclockwise.
+void seekMoveHand(struct stepper *stepper, int32_t steps)
+{
+    struct motion *motion = stepper == &hourStepper ? &hourMotion : &minuteMotion;
+    struct motion *other = stepper == &hourStepper ? &minuteMotion : &hourMotion;
+    uint32_t target = (stepperGetPosition(stepper) + STEPS_PER_REVOLUTION + steps % (int32_t)STEPS_PER_REVOLUTION) % STEPS_PER_REVOLUTION;
+    if (stepper == &hourStepper)
+        eventLogWrite(EVENT_SEEK_BEGIN, target, stepperGetPosition(&minuteStepper));
+    else
+        eventLogWrite(EVENT_SEEK_BEGIN, stepperGetPosition(&hourStepper), target);
+
+    // Going clockwise means stepping backwards (see stepperStep)
+    uint32_t remaining = steps >= 0 ? steps : -steps;
+    motionPrepare(other, 0, false);
+    do
+    {
+        uint32_t part = MIN(remaining, STEPS_PER_REVOLUTION / 2);
+        motionPrepare(motion, part, steps < 0);
+        runSeekGroup();
+        remaining -= part;
+    } while (remaining > 0);
+}
+
+/// @brief Converts the positions of the clock hands back to the time they show.
+/// @param dateTime Gets the hour (0 to 11, the hands can't tell am from pm), the minute and zero seconds. The date is left alone.
+void seekGetShownTime(datetime_t *dateTime)
+{
+    dateTime->hour = stepperGetPosition(&hourStepper) / (STEPS_PER_REVOLUTION / 12);
+    dateTime->min = stepperGetPosition(&minuteStepper);
+    dateTime->sec = 0;
+}
+
+/// @brief Packs what needs to be kept to carry on without homing into SEEK_HAND_STATE_BITS bits:
+/// position of the hour hand (6 bits), of the minute hand (6), phase of the hour motor (5) and of the minute motor (5).
+uint32_t seekGetHandState()
+{
+    return stepperGetPosition(&hourStepper) |
+           (stepperGetPosition(&minuteStepper) << 6) |
+           (stepperGetPhase(&hourStepper) << 12) |
+           (stepperGetPhase(&minuteStepper) << 17);
+}
+
+/// @brief Sets up both stepper motors with a state from seekGetHandState. Needs to be called before initStepper.
+/// @param state The packed state, bits above SEEK_HAND_STATE_BITS are ignored.
+/// @return false when the state doesn't hold valid positions, the steppers are left alone then.
+bool seekRestoreHandState(uint32_t state)
+{
+    uint32_t hourPosition = state & 0x3f;
+    uint32_t minutePosition = (state >> 6) & 0x3f;
+
+    if (hourPosition >= STEPS_PER_REVOLUTION || minutePosition >= STEPS_PER_REVOLUTION)
+        return false;
+
+    stepperRestore(&hourStepper, hourPosition, (state >> 12) & 0x1f);
+    stepperRestore(&minuteStepper, minutePosition, (state >> 17) & 0x1f);
+    return true;
+}
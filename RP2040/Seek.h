@@ -0,0 +1,18 @@
+#ifndef SEEK_H
+#define SEEK_H
+
+#include "pico/types.h"
+
+struct stepper;
+
+/// @brief Number of bits of the state returned by seekGetHandState.
+#define SEEK_HAND_STATE_BITS 22
+
+void convertTimeToSteps(datetime_t *dateTime, uint32_t *hourPosition, uint32_t *minutePosition);
+void seekClockHands(datetime_t *dateTime);
+void seekGetShownTime(datetime_t *dateTime);
+void seekMoveHand(struct stepper *stepper, int32_t steps);
+uint32_t seekGetHandState();
+bool seekRestoreHandState(uint32_t state);
+
+#endif
\ No newline at end of file
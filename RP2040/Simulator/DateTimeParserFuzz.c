@@ -0,0 +1,282 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DateTimeParser.h"
+
+// Host check of DateTimeParser.c. Valid dates and times from the whole range of the rtc get formatted
+// in all formats and have to come back as they went in (day of the week included), random and mangled
+// input has to be accepted exactly when a simple reference parser built on the C library accepts it.
+// At the end it times the parser. Exits with 1 on the first mismatch.
+
+/// @brief 4096-01-01T00:00:00, the first second the rtc can't count anymore.
+#define END_OF_RTC 67090118400ll
+
+static uint64_t randomState = 1;
+
+static uint64_t randomNext(void)
+{
+    // xorshift64*, reproducible for a given --seed
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545f4914f6cdd1dull;
+}
+
+static uint64_t randomBelow(uint64_t limit)
+{
+    return randomNext() % limit;
+}
+
+/// @brief Formats the time in the given format (0 dotted, 1 ISO 8601, 2 unix time), without seconds when withSeconds is false.
+static void formatTime(time_t time, uint32_t format, bool withSeconds, char *text, size_t size)
+{
+    struct tm t;
+    gmtime_r(&time, &t);
+
+    if (format == 0)
+        strftime(text, size, withSeconds ? "%d.%m.%y %H:%M:%S" : "%d.%m.%y %H:%M", &t);
+    else if (format == 1)
+        strftime(text, size, withSeconds ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M", &t);
+    else
+        snprintf(text, size, "%lld", (long long)time);
+}
+
+static bool matches(const char *text, const char *pattern)
+{
+    // D is a digit, T is a T or a space, the rest has to be there as it is
+    for (; *pattern != '\0'; pattern++, text++)
+    {
+        if (*pattern == 'D' ? *text < '0' || *text > '9' : *pattern == 'T' ? *text != 'T' && *text != ' ' : *text != *pattern)
+            return false;
+    }
+
+    return *text == '\0';
+}
+
+/// @brief Reference parser: checks the shape against the formats and lets timegm check the calendar.
+static bool referenceParse(const char *text, struct tm *result)
+{
+    static const char *dotted[] = {"DD.DD.DD DD:DD", "DD.DD.DD DD:DD:DD"};
+    static const char *iso[] = {"DDDD-DD-DDTDD:DD", "DDDD-DD-DDTDD:DD:DD"};
+
+    struct tm t = {0};
+    long long epoch = 0;
+    size_t length = strlen(text);
+
+    if (length >= 1 && length <= DATE_TIME_PARSER_MAX_DIGITS && strspn(text, "0123456789") == length)
+    {
+        epoch = atoll(text);
+        if (epoch >= END_OF_RTC)
+            return false;
+    }
+    else
+    {
+        if (matches(text, dotted[0]) || matches(text, dotted[1]))
+        {
+            sscanf(text, "%2d.%2d.%2d %2d:%2d:%2d", &t.tm_mday, &t.tm_mon, &t.tm_year, &t.tm_hour, &t.tm_min, &t.tm_sec);
+            t.tm_year += 2000;
+        }
+        else if (matches(text, iso[0]) || matches(text, iso[1]))
+            sscanf(text, "%4d-%2d-%2d%*c%2d:%2d:%2d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &t.tm_sec);
+        else
+            return false;
+
+        if (t.tm_mon < 1 || t.tm_mday < 1 || t.tm_hour > 23 || t.tm_min > 59 || t.tm_sec > 59)
+            return false;
+
+        // timegm moves days past the end of the month into the next one, a valid date comes back as it went in
+        struct tm normalized = t;
+        normalized.tm_year -= 1900;
+        normalized.tm_mon -= 1;
+        epoch = timegm(&normalized);
+        if (normalized.tm_mday != t.tm_mday || normalized.tm_mon != t.tm_mon - 1)
+            return false;
+    }
+
+    time_t time = epoch;
+    gmtime_r(&time, result);
+    return result->tm_year + 1900 <= 4095;
+}
+
+static bool sameTime(const datetime_t *dateTime, const struct tm *t)
+{
+    return dateTime->year == t->tm_year + 1900 && dateTime->month == t->tm_mon + 1 && dateTime->day == t->tm_mday &&
+           dateTime->dotw == t->tm_wday && dateTime->hour == t->tm_hour && dateTime->min == t->tm_min && dateTime->sec == t->tm_sec;
+}
+
+/// @brief Parses the text with both parsers and checks that they agree.
+static bool check(const char *text)
+{
+    datetime_t dateTime;
+    struct tm expected;
+
+    bool parsed = dateTimeParse(text, strlen(text), &dateTime);
+    bool valid = referenceParse(text, &expected);
+
+    if (parsed == valid && (!parsed || sameTime(&dateTime, &expected)))
+        return true;
+
+    printf("FAIL \"%s\": parser %s", text, parsed ? "accepted" : "rejected");
+    if (parsed)
+        printf(" %04d-%02d-%02d %02d:%02d:%02d dotw %d", dateTime.year, dateTime.month, dateTime.day,
+               dateTime.hour, dateTime.min, dateTime.sec, dateTime.dotw);
+    printf(", reference %s\n", valid ? "accepted" : "rejected");
+    return false;
+}
+
+/// @brief A time the rtc can count, for the dotted format only the years it can show.
+static time_t randomTime(uint32_t format)
+{
+    if (format == 0)
+        return 946684800 + randomBelow(4102444800ll - 946684800); // 2000 to 2099
+
+    return randomBelow(END_OF_RTC);
+}
+
+static void mangle(char *text, size_t size)
+{
+    static const char chars[] = "0123456789.-: TZ+x";
+    size_t length = strlen(text);
+    size_t at = length > 0 ? randomBelow(length + 1) : 0;
+    char c = chars[randomBelow(sizeof(chars) - 1)];
+
+    switch (randomBelow(3))
+    {
+    case 0: // Replace a char
+        if (at < length)
+            text[at] = c;
+        break;
+
+    case 1: // Insert a char
+        if (length + 1 < size)
+        {
+            memmove(text + at + 1, text + at, length - at + 1);
+            text[at] = c;
+        }
+        break;
+
+    default: // Drop a char
+        if (at < length)
+            memmove(text + at, text + at + 1, length - at);
+        break;
+    }
+}
+
+static double secondsSince(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t iterations = 1000000;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else
+        {
+            printf("usage: %s [--iterations N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    randomState = seed != 0 ? seed : 1;
+    char text[40];
+
+    // Every valid time in every format
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        uint32_t format = randomBelow(3);
+        formatTime(randomTime(format), format, randomBelow(2), text, sizeof(text));
+        if (!check(text))
+            return 1;
+    }
+
+    // Dates that may not exist, like the 29th of february or the 31st of april
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d", (int)randomBelow(4200), (int)randomBelow(14),
+                 (int)randomBelow(33), (int)randomBelow(25), (int)randomBelow(61), (int)randomBelow(61));
+        if (!check(text))
+            return 1;
+    }
+
+    // Valid times with a few chars replaced, added or dropped
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        uint32_t format = randomBelow(3);
+        formatTime(randomTime(format), format, randomBelow(2), text, sizeof(text));
+
+        for (uint64_t mangles = 1 + randomBelow(3); mangles > 0; mangles--)
+            mangle(text, sizeof(text));
+
+        if (!check(text))
+            return 1;
+    }
+
+    // Noise
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        static const char chars[] = "0123456789.-: T";
+        size_t length = randomBelow(24);
+
+        for (size_t c = 0; c < length; c++)
+            text[c] = chars[randomBelow(sizeof(chars) - 1)];
+        text[length] = '\0';
+
+        if (!check(text))
+            return 1;
+    }
+
+    printf("%llu times, dates, mangled times and noise checked against the reference (seed %llu)\n",
+           (unsigned long long)iterations, (unsigned long long)seed);
+
+    // Timing, with the formats mixed like they'd come in
+    enum
+    {
+        BENCHMARK_TEXTS = 1024
+    };
+    static char texts[BENCHMARK_TEXTS][40];
+    uint64_t chars = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_TEXTS; i++)
+    {
+        uint32_t format = i % 3;
+        formatTime(randomTime(format), format, i % 2, texts[i], sizeof(texts[i]));
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint32_t accepted = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        const char *t = texts[i % BENCHMARK_TEXTS];
+        size_t length = strlen(t);
+        datetime_t dateTime;
+
+        accepted += dateTimeParse(t, length, &dateTime);
+        chars += length;
+    }
+
+    double seconds = secondsSince(&start);
+    if (accepted != iterations)
+    {
+        printf("FAIL benchmark input got rejected\n");
+        return 1;
+    }
+
+    printf("%.1f ns per date and time, %.2f ns per char on the host\n", seconds * 1e9 / iterations, seconds * 1e9 / chars);
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "Simulator.h"
+
+// Follows the coils of both stepper motors on the gpio outputs and keeps track of where the clock hands point to.
+// Hand 0 is the hour hand on gpio 0-3, hand 1 the minute hand on gpio 4-7.
+// The rotor follows the direction of the magnetic field, which is worked out from the current through both coils.
+// That way wave drive and microstepping are tracked the same way.
+// The current drawn by the coils is integrated over virtual time to compare the hold modes of the steppers.
+
+#define HAND_COUNT 2
+#define STEPS_PER_REVOLUTION 60
+
+/// @brief Electrical degrees per full step.
+#define DEGREES_PER_STEP 90.0
+
+/// @brief Current of a coil driven fully on from the 3.3V rail of the Pico (DRV8833 without current limiting).
+/// The average current of a pwm driven coil is taken as proportional to its duty.
+#define COIL_CURRENT_MA 80.0
+#define SUPPLY_VOLTAGE 3.3
+
+struct hand
+{
+    /// @brief Set once a coil has been energized.
+    bool energized;
+
+    /// @brief Electrical angle of the field in degrees, the step sequence of Stepper.c is at 0, 90, 180 and 270 degrees.
+    double angle;
+
+    /// @brief Electrical degrees turned clockwise since the first energized coil.
+    double travel;
+
+    /// @brief Position in steps clockwise from 12 o'clock.
+    int32_t position;
+
+    /// @brief Field changes of more than a full step at once, the rotor can't follow those.
+    uint32_t skippedSteps;
+
+    /// @brief Virtual time of the last step and the shortest time between two steps in us.
+    uint64_t lastStepTime;
+    uint64_t shortestStepInterval;
+
+    /// @brief Current drawn by both coils since the virtual time it was last integrated at.
+    double currentMa;
+    uint64_t currentSince;
+
+    /// @brief Charge drawn by both coils in mAs.
+    double chargeMas;
+};
+
+static struct hand hands[HAND_COUNT] = {{false, 0, 0, 0, 0, 0, UINT64_MAX}, {false, 0, 0, 0, 0, 0, UINT64_MAX}};
+
+/// @brief Adds the charge drawn since the last integration to the total of the hand.
+static void integrateCurrent(struct hand *hand)
+{
+    hand->chargeMas += hand->currentMa * (simNow() - hand->currentSince) / 1e6;
+    hand->currentSince = simNow();
+}
+
+/// @brief Number of gpio writes that moved at least one hand and the number of steps they moved in total.
+static uint64_t stepWrites = 0;
+static uint64_t steps = 0;
+
+/// @brief Works out the drive of both coils of a motor from its four h-bridge inputs, -1 to 1 each.
+static void coilDrive(unsigned int hand, double *a, double *b)
+{
+    unsigned int base = hand * 4;
+
+    // Bit 0 and 1 drive coil A, bit 2 and 3 coil B (see Stepper.c)
+    *a = simGpioDrive(base + 0) - simGpioDrive(base + 1);
+    *b = simGpioDrive(base + 2) - simGpioDrive(base + 3);
+}
+
+/// @brief Works out the direction of the field of a motor from the drive of its coils.
+/// @return false when no coil is energized.
+static bool fieldAngle(double a, double b, double *angle)
+{
+    if (fabs(a) < 1e-9 && fabs(b) < 1e-9)
+        return false;
+
+    // 0b1000 (b = -1) is 0 degrees, 0b0010 (a = -1) 90, 0b0100 (b = 1) 180 and 0b0001 (a = 1) 270
+    *angle = atan2(-a, -b) * 180.0 / M_PI;
+    if (*angle < 0)
+        *angle += 360.0;
+
+    return true;
+}
+
+void simClockHandsUpdate(void)
+{
+    uint64_t stepsBefore = steps;
+
+    for (unsigned int i = 0; i < HAND_COUNT; i++)
+    {
+        struct hand *hand = &hands[i];
+
+        double a, b;
+        coilDrive(i, &a, &b);
+
+        integrateCurrent(hand);
+        hand->currentMa = (fabs(a) + fabs(b)) * COIL_CURRENT_MA;
+
+        double angle;
+        if (!fieldAngle(a, b, &angle))
+            continue;
+
+        // The hands were aligned to 12 o'clock with the first energized coil
+        if (!hand->energized)
+        {
+            hand->energized = true;
+            hand->angle = angle;
+            continue;
+        }
+
+        // The sequence runs backwards to turn the hands clockwise
+        double delta = fmod(hand->angle - angle + 540.0, 360.0) - 180.0;
+        hand->angle = angle;
+
+        if (fabs(delta) < 1e-6)
+            continue;
+
+        if (fabs(delta) > DEGREES_PER_STEP + 1e-6)
+        {
+            hand->skippedSteps++;
+            continue;
+        }
+
+        hand->travel += delta;
+
+        int32_t position = (int32_t)lround(hand->travel / DEGREES_PER_STEP) % STEPS_PER_REVOLUTION;
+        position = (position + STEPS_PER_REVOLUTION) % STEPS_PER_REVOLUTION;
+        if (position == hand->position)
+            continue;
+
+        hand->position = position;
+
+        if (hand->lastStepTime != 0 && simNow() - hand->lastStepTime < hand->shortestStepInterval)
+            hand->shortestStepInterval = simNow() - hand->lastStepTime;
+        hand->lastStepTime = simNow();
+        steps++;
+    }
+
+    if (steps != stepsBefore)
+        stepWrites++;
+}
+
+int32_t simClockHandPosition(unsigned int hand)
+{
+    return hands[hand].position;
+}
+
+uint32_t simClockHandSkippedSteps(unsigned int hand)
+{
+    return hands[hand].skippedSteps;
+}
+
+/// @brief Shortest time between two steps of the hand in us.
+uint64_t simClockHandShortestStepInterval(unsigned int hand)
+{
+    return hands[hand].shortestStepInterval;
+}
+
+/// @brief Number of gpio writes that moved at least one hand.
+uint64_t simClockHandStepWrites(void)
+{
+    return stepWrites;
+}
+
+/// @brief Number of steps taken by all hands together.
+uint64_t simClockHandSteps(void)
+{
+    return steps;
+}
+
+/// @brief Average current drawn by both coils of the hand over the whole simulation in mA.
+double simClockHandAverageCurrent(unsigned int hand)
+{
+    integrateCurrent(&hands[hand]);
+    return simNow() > 0 ? hands[hand].chargeMas * 1e6 / simNow() : 0.0;
+}
+
+/// @brief Energy drawn by both coils of the hand over the whole simulation in J.
+double simClockHandEnergy(unsigned int hand)
+{
+    integrateCurrent(&hands[hand]);
+    return hands[hand].chargeMas / 1000.0 * SUPPLY_VOLTAGE;
+}
+
+/// @brief Writes where the hands are to the file, they don't move when the chip resets.
+void simClockHandsSave(FILE *file)
+{
+    fwrite(hands, sizeof(hands), 1, file);
+    fwrite(&stepWrites, sizeof(stepWrites), 1, file);
+    fwrite(&steps, sizeof(steps), 1, file);
+}
+
+/// @brief Picks up the hands where simClockHandsSave left them. The coils are off after the reset,
+/// the current and the time of the last step start over with the virtual time.
+bool simClockHandsLoad(FILE *file)
+{
+    if (fread(hands, sizeof(hands), 1, file) != 1 ||
+        fread(&stepWrites, sizeof(stepWrites), 1, file) != 1 ||
+        fread(&steps, sizeof(steps), 1, file) != 1)
+        return false;
+
+    for (unsigned int i = 0; i < HAND_COUNT; i++)
+    {
+        hands[i].lastStepTime = 0;
+        hands[i].currentMa = 0;
+        hands[i].currentSince = 0;
+        hands[i].chargeMas = 0;
+    }
+
+    return true;
+}
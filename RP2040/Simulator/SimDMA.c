@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/structs/clocks.h"
+
+#include "Simulator.h"
+
+// Dma model: transfers into a pio tx fifo are paced by the fifo, everything else is copied at once.
+
+dma_hw_t simDma;
+
+static uint32_t claimedChannels = 0;
+
+static uint64_t dmaNextEvent(void)
+{
+    uint64_t next = SIM_NO_EVENT;
+
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        sim_dma_channel_t *ch = &simDma.ch[channel];
+        if (!ch->busy)
+            continue;
+
+        PIO pio;
+        uint sm;
+        uint64_t t = simPioIsTxFifo(ch->writeAddr, &pio, &sm) ? simPioTxSpaceAt(pio, sm) : simNow();
+        if (t < next)
+            next = t;
+    }
+
+    return next;
+}
+
+static void transferComplete(uint channel)
+{
+    simDma.ch[channel].busy = false;
+    simDma.intr |= 1u << channel;
+    simDma.ints0 = simDma.intr & simDma.inte0;
+
+    if (simDma.ints0 & (1u << channel))
+        simRaiseIrq(DMA_IRQ_0);
+}
+
+/// @brief The dma reads the buffers of the firmware from any of the sram banks over the bus fabric.
+#define DMA_CLOCKS_EN0 (CLOCKS_SLEEP_EN0_CLK_SYS_DMA_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS |                                  \
+                        CLOCKS_SLEEP_EN0_CLK_SYS_SRAM0_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_SRAM1_BITS |                                  \
+                        CLOCKS_SLEEP_EN0_CLK_SYS_SRAM2_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_SRAM3_BITS)
+#define DMA_CLOCKS_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_SRAM4_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_SRAM5_BITS)
+
+static void dmaFire(void)
+{
+    simRequireClocks("dma", DMA_CLOCKS_EN0, DMA_CLOCKS_EN1);
+
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        sim_dma_channel_t *ch = &simDma.ch[channel];
+        if (!ch->busy)
+            continue;
+
+        uint size = 1u << ch->config.size;
+        PIO pio;
+        uint sm;
+
+        if (simPioIsTxFifo(ch->writeAddr, &pio, &sm))
+        {
+            while (ch->transferCount > 0 && simPioTxSpaceAt(pio, sm) <= simNow())
+            {
+                uint32_t data = 0;
+                memcpy(&data, (const void *)ch->readAddr, size);
+                simPioPush(pio, sm, data);
+
+                if (ch->config.readIncrement)
+                    ch->readAddr = (const uint8_t *)ch->readAddr + size;
+                ch->transferCount--;
+            }
+        }
+        else
+        {
+            for (; ch->transferCount > 0; ch->transferCount--)
+            {
+                memcpy((void *)ch->writeAddr, (const void *)ch->readAddr, size);
+
+                if (ch->config.readIncrement)
+                    ch->readAddr = (const uint8_t *)ch->readAddr + size;
+                if (ch->config.writeIncrement)
+                    ch->writeAddr = (uint8_t *)ch->writeAddr + size;
+            }
+        }
+
+        if (ch->transferCount == 0)
+            transferComplete(channel);
+    }
+}
+
+static struct simEventSource dmaSource = {"dma", dmaNextEvent, dmaFire};
+
+void simDmaInit(void)
+{
+    simAddEventSource(&dmaSource);
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        if ((claimedChannels & (1u << channel)) == 0)
+        {
+            claimedChannels |= 1u << channel;
+            return channel;
+        }
+    }
+
+    if (required)
+        panic("No DMA channels are available");
+
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    claimedChannels &= ~(1u << channel);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    sim_dma_channel_t *ch = &simDma.ch[channel];
+    ch->config = *config;
+    ch->writeAddr = write_addr;
+    ch->readAddr = read_addr;
+    ch->transferCount = transfer_count;
+    ch->busy = trigger && transfer_count > 0;
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    sim_dma_channel_t *ch = &simDma.ch[channel];
+    if (ch->busy)
+        panic("DMA channel %u triggered while busy", channel);
+
+    ch->readAddr = read_addr;
+    ch->transferCount = transfer_count;
+    ch->busy = transfer_count > 0;
+}
+
+void dma_channel_abort(uint channel)
+{
+    simDma.ch[channel].busy = false;
+    simDma.ch[channel].transferCount = 0;
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    return simDma.ch[channel].busy;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    if (enabled)
+        simDma.inte0 |= 1u << channel;
+    else
+        simDma.inte0 &= ~(1u << channel);
+
+    simDma.ints0 = simDma.intr & simDma.inte0;
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    simDma.intr &= ~(1u << channel);
+    simDma.ints0 = simDma.intr & simDma.inte0;
+}
@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/sync.h"
+
+#include "Simulator.h"
+
+// Flash model: a host array that reads like XIP. Erasing sets bits, programming can only clear them like on the chip.
+// XIP is off while the flash gets written, so the firmware needs to keep both cores from running code meanwhile.
+
+/// @brief Typical times of the W25Q16JV on the Pico.
+#define FLASH_PAGE_PROGRAM_US 400
+#define FLASH_SECTOR_ERASE_US 45000
+
+uint8_t simFlash[PICO_FLASH_SIZE_BYTES];
+
+/// @brief Set when the contents came from the run before a reset.
+static bool loaded = false;
+
+/// @brief Checks that nothing can run from flash while it gets written.
+static void checkXipUnused(const char *operation)
+{
+    if (simGetInterruptsEnabled())
+        simPanic("%s with interrupts enabled, a handler would run from flash", operation);
+
+    if (!simCore1Stopped())
+        simPanic("%s while core 1 runs", operation);
+}
+
+/// @brief The flash starts out erased unless it got loaded.
+void simFlashInit(void)
+{
+    if (!loaded)
+        memset(simFlash, 0xff, sizeof(simFlash));
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    checkXipUnused("flash_range_erase");
+
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 || flash_offs + count > sizeof(simFlash))
+        simPanic("flash_range_erase of %zu bytes at 0x%x isn't sector aligned", count, flash_offs);
+
+    memset(&simFlash[flash_offs], 0xff, count);
+    simAdvanceBy((uint64_t)count / FLASH_SECTOR_SIZE * FLASH_SECTOR_ERASE_US);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    checkXipUnused("flash_range_program");
+
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 || flash_offs + count > sizeof(simFlash))
+        simPanic("flash_range_program of %zu bytes at 0x%x isn't page aligned", count, flash_offs);
+
+    for (size_t i = 0; i < count; i++)
+        simFlash[flash_offs + i] &= data[i];
+    simAdvanceBy((uint64_t)count / FLASH_PAGE_SIZE * FLASH_PAGE_PROGRAM_US);
+}
+
+/// @brief Writes the flash to the file, it keeps its contents over resets and power cycles.
+void simFlashSave(FILE *file)
+{
+    fwrite(simFlash, sizeof(simFlash), 1, file);
+}
+
+bool simFlashLoad(FILE *file)
+{
+    loaded = true;
+    return fread(simFlash, sizeof(simFlash), 1, file) == 1;
+}
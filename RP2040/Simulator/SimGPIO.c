@@ -0,0 +1,166 @@
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#include "Simulator.h"
+
+#define NUM_GPIOS 30
+
+/// @brief Output values driven by SIO.
+static uint32_t out = 0;
+
+/// @brief Output enables driven by SIO.
+static uint32_t oe = 0;
+
+/// @brief Levels driven into the chip from the outside (usb power detection).
+static uint32_t in = 0;
+
+static enum gpio_function function[NUM_GPIOS];
+
+static uint32_t irqEnabledEvents[NUM_GPIOS];
+static uint32_t irqPendingEvents[NUM_GPIOS];
+static gpio_irq_callback_t irqCallback = NULL;
+
+/// @brief How strongly the pin drives its output from 0 (low) to 1 (high). Pins given to a pio are driven by its
+/// state machines and pwm pins by their duty cycle.
+double simGpioDrive(uint gpio)
+{
+    uint32_t bit = 1u << gpio;
+
+    switch (function[gpio])
+    {
+    case GPIO_FUNC_SIO:
+        return (oe & out & bit) ? 1.0 : 0.0;
+    case GPIO_FUNC_PIO0:
+        return (pio0->pinValues & bit) ? 1.0 : 0.0;
+    case GPIO_FUNC_PIO1:
+        return (pio1->pinValues & bit) ? 1.0 : 0.0;
+    case GPIO_FUNC_PWM:
+        return simPwmDuty(gpio);
+    default:
+        return 0.0;
+    }
+}
+
+/// @brief Lets the clock hands follow a change of the outputs.
+void simGpioUpdateOutputs(void)
+{
+    simClockHandsUpdate();
+}
+
+static void gpioIrqHandler(void)
+{
+    for (uint gpio = 0; gpio < NUM_GPIOS; gpio++)
+    {
+        uint32_t events = irqPendingEvents[gpio] & irqEnabledEvents[gpio];
+        irqPendingEvents[gpio] = 0;
+
+        if (events != 0 && irqCallback != NULL)
+            irqCallback(gpio, events);
+    }
+}
+
+void simGpioInit(void)
+{
+    for (uint gpio = 0; gpio < NUM_GPIOS; gpio++)
+        function[gpio] = GPIO_FUNC_NULL;
+
+    simSetIrqHandler(IO_IRQ_BANK0, gpioIrqHandler);
+}
+
+/// @brief Drives a gpio from the outside and raises the edge interrupts for it.
+void simGpioSetInput(uint gpio, bool level)
+{
+    bool previous = (in >> gpio) & 1u;
+    if (previous == level)
+        return;
+
+    if (level)
+        in |= 1u << gpio;
+    else
+        in &= ~(1u << gpio);
+
+    irqPendingEvents[gpio] |= level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (irqPendingEvents[gpio] & irqEnabledEvents[gpio])
+        simRaiseIrq(IO_IRQ_BANK0);
+}
+
+void gpio_init(uint gpio)
+{
+    gpio_init_mask(1u << gpio);
+}
+
+void gpio_init_mask(uint gpio_mask)
+{
+    oe &= ~gpio_mask;
+    out &= ~gpio_mask;
+
+    for (uint gpio = 0; gpio < NUM_GPIOS; gpio++)
+        if (gpio_mask & (1u << gpio))
+            function[gpio] = GPIO_FUNC_SIO;
+
+    simGpioUpdateOutputs();
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    function[gpio] = fn;
+    simGpioUpdateOutputs();
+}
+
+enum gpio_function gpio_get_function(uint gpio)
+{
+    return function[gpio];
+}
+
+void gpio_set_dir(uint gpio, bool out_)
+{
+    if (out_)
+        oe |= 1u << gpio;
+    else
+        oe &= ~(1u << gpio);
+}
+
+void gpio_set_dir_out_masked(uint32_t mask)
+{
+    oe |= mask;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    gpio_put_masked(1u << gpio, value ? (1u << gpio) : 0);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value)
+{
+    out = (out & ~mask) | (value & mask);
+    simGpioUpdateOutputs();
+}
+
+bool gpio_get(uint gpio)
+{
+    if (oe & (1u << gpio))
+        return (out >> gpio) & 1u;
+
+    return (in >> gpio) & 1u;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    // The sdk acknowledges stale edges before changing the enables
+    irqPendingEvents[gpio] &= ~events;
+
+    if (enabled)
+        irqEnabledEvents[gpio] |= events;
+    else
+        irqEnabledEvents[gpio] &= ~events;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    irqCallback = callback;
+    gpio_set_irq_enabled(gpio, events, enabled);
+
+    if (enabled)
+        irq_set_enabled(IO_IRQ_BANK0, true);
+}
@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "pico/multicore.h"
+#include "hardware/structs/scb.h"
+
+#include "Simulator.h"
+
+// Core 1 runs as a coroutine on its own stack. Its code takes no virtual time, it runs whenever
+// core 0 lets time pass and hands control back when it waits (wfe, sleep).
+
+#define CORE1_STACK_SIZE (256 * 1024)
+
+static ucontext_t core0Context;
+static ucontext_t core1Context;
+static void (*core1Entry)(void) = NULL;
+
+static bool core1Launched = false;
+static bool onCore1 = false;
+
+/// @brief Event register of core 1, set by sev on either core.
+static bool core1Event = false;
+
+/// @brief Core 1 is waiting in wfe or sleep.
+static bool core1Waiting = false;
+static bool core1WakesOnEvent = false;
+static uint64_t core1WakeTime = SIM_NO_EVENT;
+
+/// @brief Core 1 takes part in the lockout and core 0 currently holds it there.
+static bool lockoutVictim = false;
+static bool lockedOut = false;
+
+static bool core1Runnable(void)
+{
+    if (!core1Launched || lockedOut)
+        return false;
+
+    if (!core1Waiting)
+        return true;
+
+    return (core1WakesOnEvent && core1Event) || simNow() >= core1WakeTime;
+}
+
+static void core1Trampoline(void)
+{
+    core1Entry();
+    simPanic("Core 1 returned from its entry function");
+}
+
+/// @brief Lets core 1 run until it waits again.
+void simRunCore1(void)
+{
+    if (onCore1)
+        return;
+
+    while (core1Runnable())
+    {
+        if (core1Waiting && core1WakesOnEvent && core1Event)
+            core1Event = false;
+
+        core1Waiting = false;
+        onCore1 = true;
+        swapcontext(&core0Context, &core1Context);
+        onCore1 = false;
+    }
+}
+
+/// @brief Hands control from core 1 back to core 0 until the wake time or an event.
+static void core1Wait(uint64_t wakeTime, bool wakesOnEvent)
+{
+    core1Waiting = true;
+    core1WakesOnEvent = wakesOnEvent;
+    core1WakeTime = wakeTime;
+
+    swapcontext(&core1Context, &core0Context);
+}
+
+/// @brief Indicates whether core 1 is in deep sleep, in wfe with SLEEPDEEP set in its scr (or hasn't been started),
+/// which is needed for the clocks to get gated.
+bool simCore1Sleeping(void)
+{
+    return !core1Launched || (core1Waiting && core1WakesOnEvent && (simScb[1].scr & M0PLUS_SCR_SLEEPDEEP_BITS));
+}
+
+bool simOnCore1(void)
+{
+    return onCore1;
+}
+
+/// @brief wfe on core 1. Returns right away if the event register is set.
+void simCore1WaitForEvent(void)
+{
+    if (core1Event)
+    {
+        core1Event = false;
+        return;
+    }
+
+    core1Wait(SIM_NO_EVENT, true);
+}
+
+/// @brief Busy waits and sleeps on core 1.
+void simCore1SleepUntil(uint64_t timeUs)
+{
+    while (simNow() < timeUs)
+        core1Wait(timeUs, false);
+}
+
+void simSendEvent(void)
+{
+    core1Event = true;
+}
+
+static uint64_t core1NextEvent(void)
+{
+    return core1Launched && core1Waiting ? core1WakeTime : SIM_NO_EVENT;
+}
+
+static void core1Fire(void)
+{
+    simRunCore1();
+}
+
+static struct simEventSource core1Source = {"core 1", core1NextEvent, core1Fire};
+
+void simMulticoreInit(void)
+{
+    simAddEventSource(&core1Source);
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    if (core1Launched)
+        panic("Core 1 is already running");
+
+    getcontext(&core1Context);
+    core1Context.uc_stack.ss_sp = malloc(CORE1_STACK_SIZE);
+    core1Context.uc_stack.ss_size = CORE1_STACK_SIZE;
+    core1Context.uc_link = NULL;
+    makecontext(&core1Context, core1Trampoline, 0);
+
+    // Core 1 starts from reset, without SLEEPDEEP
+    simScb[1].scr = 0;
+    core1Entry = entry;
+    core1Launched = true;
+    core1Waiting = false;
+}
+
+void multicore_reset_core1(void)
+{
+    if (onCore1)
+        panic("Core 1 can't reset itself");
+
+    core1Launched = false;
+}
+
+void multicore_lockout_victim_init(void)
+{
+    if (!onCore1)
+        panic("Only core 1 can be locked out");
+
+    lockoutVictim = true;
+}
+
+/// @brief Core 1 stops wherever it waits right now and doesn't run again until the lockout ends.
+void multicore_lockout_start_blocking(void)
+{
+    if (onCore1)
+        panic("Core 1 can't lock out core 0");
+
+    if (core1Launched && !lockoutVictim)
+        simPanic("Core 1 never called multicore_lockout_victim_init, the lockout would block forever");
+
+    lockedOut = true;
+}
+
+void multicore_lockout_end_blocking(void)
+{
+    lockedOut = false;
+}
+
+/// @brief Indicates whether core 1 can't run any code right now, which is needed while the flash is written.
+bool simCore1Stopped(void)
+{
+    return !core1Launched || lockedOut;
+}
+
+uint get_core_num(void)
+{
+    return onCore1 ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/structs/clocks.h"
+
+#include "Simulator.h"
+
+// Pio model: programs are recognised by their instructions and their behaviour is modelled
+// instead of executing them. The ws2812 program shifts out one word per pixel, the step generator
+// waits the delay of every word and then writes its pins.
+
+#define MAX_FIFO_DEPTH 8
+#define MAX_PIXELS 64
+
+/// @brief A WS2812 chain latches the shifted in data once the line stays low for this long.
+#define WS2812_RESET_US 50
+
+pio_hw_t simPio0 = {0};
+pio_hw_t simPio1 = {1};
+
+struct smFifo
+{
+    /// @brief Virtual times at which the words still in the tx fifo get pulled by the state machine.
+    uint64_t pullTimes[MAX_FIFO_DEPTH];
+    uint level;
+
+    /// @brief Virtual time at which the state machine is done shifting out the last word.
+    uint64_t busyUntil;
+};
+
+static struct smFifo fifos[2][NUM_PIO_STATE_MACHINES];
+
+/// @brief Pin writes of the step generator that are still to come.
+#define MAX_PIN_WRITES 16
+
+struct pinWrite
+{
+    PIO pio;
+    uint sm;
+    uint64_t time;
+    uint32_t values;
+    bool raisesIrq;
+};
+
+static struct pinWrite pinWrites[MAX_PIN_WRITES];
+static uint pinWriteCount = 0;
+
+static uint32_t pixels[MAX_PIXELS];
+static uint pixelIndex = 0;
+static uint64_t framesShown = 0;
+
+static bool isWs2812Program(const pio_program_t *program)
+{
+    return program != NULL && program->length == 4 && program->instructions[0] == 0x6221;
+}
+
+static bool isStepGeneratorProgram(const pio_program_t *program)
+{
+    return program != NULL && program->length == 6 && program->instructions[0] == 0x6037;
+}
+
+static uint fifoDepth(PIO pio, uint sm)
+{
+    return (pio->sm[sm].config.shiftctrl & PIO_SM_SHIFTCTRL_FJOIN_TX_BITS) ? 8 : 4;
+}
+
+/// @brief Time of one cycle of the state machine in us.
+static double cycleTimeUs(PIO pio, uint sm)
+{
+    const pio_sm_config *config = &pio->sm[sm].config;
+    double div = (config->clkdiv >> PIO_SM_CLKDIV_INT_LSB) + ((config->clkdiv >> 8) & 0xffu) / 256.0;
+    return div * 1e6 / clock_get_hz(clk_sys);
+}
+
+/// @brief Time the state machine needs to shift out one word in us.
+static double wordTimeUs(PIO pio, uint sm)
+{
+    const pio_sm_config *config = &pio->sm[sm].config;
+    uint bits = (config->shiftctrl >> PIO_SM_SHIFTCTRL_PULL_THRESH_LSB) & 0x1fu;
+    if (bits == 0)
+        bits = 32;
+
+    // ws2812 program: T1 + T2 + T3 cycles per bit
+    return bits * 10 * cycleTimeUs(pio, sm);
+}
+
+/// @brief Removes the words from the fifo that the state machine has pulled by now.
+static void updateFifo(struct smFifo *fifo)
+{
+    uint pulled = 0;
+    while (pulled < fifo->level && fifo->pullTimes[pulled] <= simNow())
+        pulled++;
+
+    for (uint i = pulled; i < fifo->level; i++)
+        fifo->pullTimes[i - pulled] = fifo->pullTimes[i];
+    fifo->level -= pulled;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+    // Programs get loaded to the top of the instruction memory like the sdk does
+    uint offset = 32 - program->length;
+    while ((pio->usedInstructions >> offset) & ((1u << program->length) - 1))
+    {
+        if (offset == 0)
+            panic("No program space");
+        offset--;
+    }
+
+    pio->usedInstructions |= ((1u << program->length) - 1) << offset;
+    pio->programs[offset] = program;
+    return offset;
+}
+
+void pio_gpio_init(PIO pio, uint pin)
+{
+    gpio_set_function(pin, pio->index == 0 ? GPIO_FUNC_PIO0 : GPIO_FUNC_PIO1);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out)
+{
+    pio->sm[sm].pinBase = pin_base;
+    pio->sm[sm].pinCount = pin_count;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config)
+{
+    pio->sm[sm].enabled = false;
+    pio->sm[sm].program = pio->programs[initial_pc];
+    pio->sm[sm].config = *config;
+
+    struct smFifo *fifo = &fifos[pio->index][sm];
+    fifo->level = 0;
+    fifo->busyUntil = 0;
+}
+
+/// @brief Takes effect from the next word the state machine pulls.
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div)
+{
+    sm_config_set_clkdiv(&pio->sm[sm].config, div);
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    pio->sm[sm].enabled = enabled;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm)
+{
+    return pio_sm_get_tx_fifo_level(pio, sm) >= fifoDepth(pio, sm);
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm)
+{
+    struct smFifo *fifo = &fifos[pio->index][sm];
+    updateFifo(fifo);
+    return fifo->level;
+}
+
+/// @brief Virtual time at which the tx fifo has space for another word.
+uint64_t simPioTxSpaceAt(PIO pio, uint sm)
+{
+    struct smFifo *fifo = &fifos[pio->index][sm];
+
+    updateFifo(fifo);
+    return fifo->level < fifoDepth(pio, sm) ? simNow() : fifo->pullTimes[0];
+}
+
+/// @brief Pulls a pixel into the ws2812 program.
+/// @return Virtual time at which the state machine is done with the word.
+static uint64_t ws2812Pull(PIO pio, uint sm, struct smFifo *fifo, uint64_t pullTime, uint32_t data)
+{
+    // The line was idle long enough for the leds to latch the previous frame
+    if (pullTime >= fifo->busyUntil + WS2812_RESET_US || framesShown == 0)
+    {
+        framesShown++;
+        pixelIndex = 0;
+    }
+
+    if (pixelIndex < MAX_PIXELS)
+        pixels[pixelIndex++] = data >> 8;
+
+    return pullTime + (uint64_t)(wordTimeUs(pio, sm) + 0.5);
+}
+
+/// @brief Pulls a step into the step generator program and queues its pin write.
+/// @return Virtual time at which the state machine is done with the word.
+static uint64_t stepGeneratorPull(PIO pio, uint sm, uint64_t pullTime, uint32_t data)
+{
+    uint32_t delay = data & ((1u << 23) - 1);
+    bool last = (data >> 31) != 0;
+    double cycle = cycleTimeUs(pio, sm);
+
+    if (pinWriteCount == MAX_PIN_WRITES)
+        panic("Too many step generator pin writes in flight");
+
+    // out x, the delay loop and out pins
+    struct pinWrite *write = &pinWrites[pinWriteCount++];
+    write->pio = pio;
+    write->sm = sm;
+    write->time = pullTime + (uint64_t)((delay + 2) * cycle + 0.5);
+    write->values = (data >> 23) & 0xffu;
+    write->raisesIrq = last;
+
+    // out y and jmp, the irq takes another cycle
+    return pullTime + (uint64_t)((delay + (last ? 6 : 5)) * cycle + 0.5);
+}
+
+/// @brief Checks that the pio block is clocked while it does something.
+static void requirePioClock(PIO pio)
+{
+    if (pio->index == 0)
+        simRequireClocks("pio0", CLOCKS_SLEEP_EN0_CLK_SYS_PIO0_BITS, 0);
+    else
+        simRequireClocks("pio1", CLOCKS_SLEEP_EN0_CLK_SYS_PIO1_BITS, 0);
+}
+
+/// @brief Puts a word into the tx fifo, which needs to have space for it.
+void simPioPush(PIO pio, uint sm, uint32_t data)
+{
+    requirePioClock(pio);
+
+    const pio_program_t *program = pio->sm[sm].program;
+    if (!pio->sm[sm].enabled || (!isWs2812Program(program) && !isStepGeneratorProgram(program)))
+        panic("Pushing into the fifo of a state machine that never pulls");
+
+    struct smFifo *fifo = &fifos[pio->index][sm];
+    updateFifo(fifo);
+    if (fifo->level >= fifoDepth(pio, sm))
+        panic("Pushing into a full fifo");
+
+    uint64_t pullTime = fifo->busyUntil > simNow() ? fifo->busyUntil : simNow();
+
+    fifo->pullTimes[fifo->level++] = pullTime;
+    if (isWs2812Program(program))
+        fifo->busyUntil = ws2812Pull(pio, sm, fifo, pullTime, data);
+    else
+        fifo->busyUntil = stepGeneratorPull(pio, sm, pullTime, data);
+}
+
+/// @brief Finds the state machine a tx fifo register belongs to.
+bool simPioIsTxFifo(volatile void *address, PIO *pio, uint *sm)
+{
+    PIO pios[] = {pio0, pio1};
+
+    for (uint i = 0; i < count_of(pios); i++)
+        for (uint j = 0; j < NUM_PIO_STATE_MACHINES; j++)
+            if (address == &pios[i]->txf[j])
+            {
+                *pio = pios[i];
+                *sm = j;
+                return true;
+            }
+
+    return false;
+}
+
+/// @brief Pushes a word into the tx fifo. Virtual time passes while the fifo is full.
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+    // The cpu spins until the state machine pulls the oldest word
+    simAdvanceTo(simPioTxSpaceAt(pio, sm));
+    simPioPush(pio, sm, data);
+}
+
+uint64_t simPioFramesShown(void)
+{
+    return framesShown;
+}
+
+/// @brief Color of a led of the last frame in GRB order.
+uint32_t simPioPixel(uint index)
+{
+    return index < pixelIndex ? pixels[index] : 0;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask)
+{
+    pio->pinValues = (pio->pinValues & ~pin_mask) | (pin_values & pin_mask);
+    simGpioUpdateOutputs();
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled)
+{
+    if (enabled)
+        pio->inte0 |= 1u << source;
+    else
+        pio->inte0 &= ~(1u << source);
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num)
+{
+    pio->irq &= ~(1u << pio_interrupt_num);
+}
+
+static uint64_t pioNextEvent(void)
+{
+    uint64_t next = SIM_NO_EVENT;
+
+    for (uint i = 0; i < pinWriteCount; i++)
+        if (pinWrites[i].time < next)
+            next = pinWrites[i].time;
+
+    return next;
+}
+
+/// @brief Performs the pin writes of the step generator that are due.
+static void pioFire(void)
+{
+    uint i = 0;
+    while (i < pinWriteCount)
+    {
+        struct pinWrite write = pinWrites[i];
+        if (write.time > simNow())
+        {
+            i++;
+            continue;
+        }
+
+        pinWrites[i] = pinWrites[--pinWriteCount];
+        requirePioClock(write.pio);
+
+        uint base = (write.pio->sm[write.sm].config.pinctrl >> PIO_SM_PINCTRL_OUT_BASE_LSB) & 0x1fu;
+        uint count = (write.pio->sm[write.sm].config.pinctrl >> PIO_SM_PINCTRL_OUT_COUNT_LSB) & 0x3fu;
+        pio_sm_set_pins_with_mask(write.pio, write.sm, write.values << base, ((1u << count) - 1) << base);
+
+        if (write.raisesIrq)
+        {
+            write.pio->irq |= 1u;
+            if (write.pio->inte0 & (1u << pis_interrupt0))
+                simRaiseIrq(write.pio->index == 0 ? PIO0_IRQ_0 : PIO1_IRQ_0);
+        }
+    }
+}
+
+static struct simEventSource pioSource = {"pio", pioNextEvent, pioFire};
+
+void simPioInit(void)
+{
+    simAddEventSource(&pioSource);
+}
@@ -0,0 +1,266 @@
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/clocks.h"
+
+#include "Simulator.h"
+
+// Pwm model: outputs are seen as their average duty cycle. Counter wraps are only simulated for slices
+// with their wrap irq enabled so free running slices cost nothing. Compare values are double buffered
+// like on the chip and only show on the outputs from the next wrap on.
+
+pwm_hw_t simPwm;
+
+/// @brief Compare values the outputs currently run with.
+static uint32_t latchedCc[NUM_PWM_SLICES];
+
+/// @brief Slices with a compare value that has been written but not latched yet.
+static uint32_t pendingLatch = 0;
+
+/// @brief Virtual time at which each slice got enabled, its counter wraps a whole number of periods after.
+static uint64_t enabledAt[NUM_PWM_SLICES];
+
+/// @brief Virtual time of the next wrap of every slice.
+static uint64_t nextWrap[NUM_PWM_SLICES];
+
+/// @brief Enable bits the wrap times were calculated for.
+static uint32_t trackedEn = 0;
+
+static uint64_t wrapPeriodUs(uint slice)
+{
+    // div is 8.4 fixed point
+    uint64_t cycles = (uint64_t)(simPwm.slice[slice].top + 1) * simPwm.slice[slice].div;
+    uint64_t period = (cycles * 1000000u) / ((uint64_t)clock_get_hz(clk_sys) << 4);
+    return period > 0 ? period : 1;
+}
+
+/// @brief Slices whose wraps are simulated.
+static uint32_t wrappingSlices(void)
+{
+    return simPwm.en & simPwm.inte;
+}
+
+/// @brief Picks up slices that got enabled or disabled by writing the registers.
+static void trackEnables(void)
+{
+    uint32_t changed = wrappingSlices() ^ trackedEn;
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+        if ((changed & wrappingSlices()) & (1u << slice))
+            nextWrap[slice] = simNow() + wrapPeriodUs(slice);
+
+    trackedEn = wrappingSlices();
+}
+
+static uint64_t pwmNextEvent(void)
+{
+    trackEnables();
+
+    uint64_t next = SIM_NO_EVENT;
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+        if ((wrappingSlices() & (1u << slice)) && nextWrap[slice] < next)
+            next = nextWrap[slice];
+
+    return next;
+}
+
+static void pwmFire(void)
+{
+    simRequireClocks("pwm", CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS, 0);
+
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+    {
+        if ((wrappingSlices() & (1u << slice)) == 0 || nextWrap[slice] > simNow())
+            continue;
+
+        nextWrap[slice] += wrapPeriodUs(slice);
+        simPwm.intr |= 1u << slice;
+    }
+
+    simPwm.ints = simPwm.intr & simPwm.inte;
+    if (simPwm.ints)
+        simRaiseIrq(PWM_IRQ_WRAP);
+}
+
+static struct simEventSource pwmSource = {"pwm", pwmNextEvent, pwmFire};
+
+/// @brief Virtual time of the first wrap of the slice after now.
+static uint64_t nextWrapAfterNow(uint slice)
+{
+    uint64_t period = wrapPeriodUs(slice);
+    return enabledAt[slice] + ((simNow() - enabledAt[slice]) / period + 1) * period;
+}
+
+static uint64_t latchNextEvent(void)
+{
+    uint64_t next = SIM_NO_EVENT;
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+    {
+        if ((pendingLatch & (1u << slice)) == 0)
+            continue;
+
+        uint64_t t = nextWrapAfterNow(slice);
+        if (t < next)
+            next = t;
+    }
+
+    return next;
+}
+
+/// @brief Latches the compare values of all slices that wrap now.
+static void latchFire(void)
+{
+    simRequireClocks("pwm", CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS, 0);
+
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+    {
+        if ((pendingLatch & (1u << slice)) == 0)
+            continue;
+
+        uint64_t period = wrapPeriodUs(slice);
+        if ((simNow() - enabledAt[slice]) % period != 0)
+            continue;
+
+        latchedCc[slice] = simPwm.slice[slice].cc;
+        pendingLatch &= ~(1u << slice);
+    }
+
+    simGpioUpdateOutputs();
+}
+
+static struct simEventSource latchSource = {"pwm latch", latchNextEvent, latchFire};
+
+/// @brief Takes over the written compare values right away, for slices that aren't running.
+static void latchNow(uint slice)
+{
+    latchedCc[slice] = simPwm.slice[slice].cc;
+    pendingLatch &= ~(1u << slice);
+}
+
+/// @brief Picks up a change of the enable bit of a slice. The counter starts from zero when it gets enabled.
+static void enableChanged(uint slice, bool wasEnabled)
+{
+    bool enabled = (simPwm.en & (1u << slice)) != 0;
+
+    if (enabled && !wasEnabled)
+        enabledAt[slice] = simNow();
+
+    if (!enabled || !wasEnabled)
+        latchNow(slice);
+}
+
+void simPwmInit(void)
+{
+    simAddEventSource(&pwmSource);
+    simAddEventSource(&latchSource);
+}
+
+/// @brief Average level of a pwm output from 0 to 1.
+double simPwmDuty(uint gpio)
+{
+    uint slice = pwm_gpio_to_slice_num(gpio);
+    if ((simPwm.en & (1u << slice)) == 0)
+        return 0.0;
+
+    uint32_t level = pwm_gpio_to_channel(gpio) == PWM_CHAN_A ? latchedCc[slice] & 0xffffu : latchedCc[slice] >> 16;
+    double duty = (double)level / (simPwm.slice[slice].top + 1);
+    return duty < 1.0 ? duty : 1.0;
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+    simPwm.slice[slice_num].csr = 0;
+    simPwm.slice[slice_num].ctr = 0;
+    simPwm.slice[slice_num].cc = 0;
+    simPwm.slice[slice_num].top = c->top;
+    simPwm.slice[slice_num].div = c->div;
+    simPwm.slice[slice_num].csr = c->csr;
+    pwm_set_enabled(slice_num, start);
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+    simPwm.slice[slice_num].top = wrap;
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract)
+{
+    simPwm.slice[slice_num].div = (((uint)integer) << PWM_CH0_DIV_INT_LSB) | (fract & 0xfu);
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level)
+{
+    if (chan == PWM_CHAN_A)
+        simPwm.slice[slice_num].cc = (simPwm.slice[slice_num].cc & 0xffff0000u) | level;
+    else
+        simPwm.slice[slice_num].cc = (simPwm.slice[slice_num].cc & 0x0000ffffu) | ((uint32_t)level << 16);
+
+    if (simPwm.en & (1u << slice_num))
+        pendingLatch |= 1u << slice_num;
+    else
+        latchNow(slice_num);
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    bool wasEnabled = (simPwm.en & (1u << slice_num)) != 0;
+
+    if (enabled)
+    {
+        simPwm.slice[slice_num].csr |= PWM_CH0_CSR_EN_BITS;
+        simPwm.en |= 1u << slice_num;
+    }
+    else
+    {
+        simPwm.slice[slice_num].csr &= ~PWM_CH0_CSR_EN_BITS;
+        simPwm.en &= ~(1u << slice_num);
+    }
+
+    enableChanged(slice_num, wasEnabled);
+    simGpioUpdateOutputs();
+}
+
+/// @brief All slices change at the same time like the single register write of the sdk.
+void pwm_set_mask_enabled(uint32_t mask)
+{
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+    {
+        if ((mask >> slice) & 1u)
+            simPwm.slice[slice].csr |= PWM_CH0_CSR_EN_BITS;
+        else
+            simPwm.slice[slice].csr &= ~PWM_CH0_CSR_EN_BITS;
+    }
+
+    uint32_t wasEnabled = simPwm.en;
+    simPwm.en = mask;
+
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++)
+        enableChanged(slice, (wasEnabled >> slice) & 1u);
+
+    simGpioUpdateOutputs();
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled)
+{
+    if (enabled)
+        simPwm.inte |= 1u << slice_num;
+    else
+        simPwm.inte &= ~(1u << slice_num);
+
+    simPwm.ints = simPwm.intr & simPwm.inte;
+}
+
+void pwm_clear_irq(uint slice_num)
+{
+    simPwm.intr &= ~(1u << slice_num);
+    simPwm.ints = simPwm.intr & simPwm.inte;
+}
+
+uint32_t pwm_get_irq_status_mask(void)
+{
+    return simPwm.ints;
+}
@@ -0,0 +1,260 @@
+#include "hardware/irq.h"
+#include "hardware/rtc.h"
+#include "hardware/structs/clocks.h"
+
+#include "Simulator.h"
+
+// Rtc model: the time is kept as seconds since 1970 that were loaded at a point in virtual time.
+// Virtual time is the real time, the rtc runs simScenario.rtcPpb fast against it (slow when negative).
+
+static bool running = false;
+static int64_t loadedEpoch;
+static uint64_t loadedAtUs;
+
+/// @brief The time the rtc got loaded with first in us, at virtual time 0. What the time really is.
+static bool everLoaded = false;
+static int64_t firstLoadOriginUs;
+
+static bool alarmEnabled = false;
+static datetime_t alarm;
+static rtc_callback_t alarmCallback = NULL;
+
+/// @brief Virtual time at which the alarm irq held back by simScenario.lateAlarmAtUs gets raised, 0 when there is none.
+static uint64_t lateAlarmUs = 0;
+
+/// @brief Days since 1970-01-01 for the given date (proleptic gregorian calendar).
+static int64_t daysFromCivil(int64_t year, int64_t month, int64_t day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t *year, int64_t *month, int64_t *day)
+{
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t mp = (5 * dayOfYear + 2) / 153;
+    *day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static int64_t datetimeToEpoch(const datetime_t *t)
+{
+    return daysFromCivil(t->year, t->month, t->day) * 86400 + t->hour * 3600 + t->min * 60 + t->sec;
+}
+
+static void epochToDatetime(int64_t epoch, datetime_t *t)
+{
+    int64_t days = epoch / 86400;
+    int64_t secondOfDay = epoch % 86400;
+    int64_t year, month, day;
+    civilFromDays(days, &year, &month, &day);
+
+    t->year = year;
+    t->month = month;
+    t->day = day;
+    t->dotw = (days + 4) % 7; // 1970-01-01 was a thursday
+    t->hour = secondOfDay / 3600;
+    t->min = (secondOfDay / 60) % 60;
+    t->sec = secondOfDay % 60;
+}
+
+/// @brief Microseconds the rtc has counted since it got loaded.
+static int64_t rtcElapsedUs(void)
+{
+    return (__int128)(simNow() - loadedAtUs) * (1000000000 + simScenario.rtcPpb) / 1000000000;
+}
+
+/// @brief Virtual time at which the rtc will have counted the given microseconds since it got loaded.
+static uint64_t rtcTimeOf(int64_t elapsedUs)
+{
+    __int128 scaled = (__int128)elapsedUs * 1000000000;
+    int64_t rate = 1000000000 + simScenario.rtcPpb;
+    return loadedAtUs + (uint64_t)((scaled + rate - 1) / rate);
+}
+
+bool simRtcGetEpoch(int64_t *epoch)
+{
+    if (!running)
+        return false;
+
+    *epoch = loadedEpoch + rtcElapsedUs() / 1000000;
+    return true;
+}
+
+/// @brief Like simRtcGetEpoch but to the microsecond, the rtc counts its seconds from the moment it got set.
+bool simRtcGetEpochUs(int64_t *epochUs)
+{
+    if (!running)
+        return false;
+
+    *epochUs = loadedEpoch * 1000000 + rtcElapsedUs();
+    return true;
+}
+
+/// @brief The time the rtc got first loaded with in this run, taken back to virtual time 0 in us.
+/// @return false when it wasn't loaded yet.
+bool simRtcGetFirstLoadOrigin(int64_t *originUs)
+{
+    *originUs = firstLoadOriginUs;
+    return everLoaded;
+}
+
+static bool alarmMatches(int64_t epoch)
+{
+    datetime_t t;
+    epochToDatetime(epoch, &t);
+
+    return (alarm.year < 0 || alarm.year == t.year) &&
+           (alarm.month < 0 || alarm.month == t.month) &&
+           (alarm.day < 0 || alarm.day == t.day) &&
+           (alarm.dotw < 0 || alarm.dotw == t.dotw) &&
+           (alarm.hour < 0 || alarm.hour == t.hour) &&
+           (alarm.min < 0 || alarm.min == t.min) &&
+           (alarm.sec < 0 || alarm.sec == t.sec);
+}
+
+/// @brief The alarm irq is raised when the time changes to a matching second.
+static uint64_t rtcNextEvent(void)
+{
+    // Raised once it's due even if the firmware turned the alarm off meanwhile, like an irq that was pending
+    if (lateAlarmUs != 0)
+        return lateAlarmUs;
+
+    int64_t epoch;
+    if (!alarmEnabled || !simRtcGetEpoch(&epoch))
+        return SIM_NO_EVENT;
+
+    int64_t candidate = epoch + 1;
+    int64_t increment = 1;
+    if (alarm.sec >= 0)
+    {
+        candidate += ((alarm.sec - candidate % 60) + 60) % 60;
+        increment = 60;
+    }
+
+    // Give up after about a year worth of candidates
+    for (uint32_t i = 0; i < 600000; i++, candidate += increment)
+        if (alarmMatches(candidate))
+        {
+            uint64_t alarmUs = rtcTimeOf((candidate - loadedEpoch) * 1000000);
+
+            // The first alarm from then on comes late, the ones that would have come meanwhile are lost with it
+            if (alarmUs >= simScenario.lateAlarmAtUs)
+            {
+                lateAlarmUs = alarmUs + simScenario.lateAlarmDelayUs;
+                simScenario.lateAlarmAtUs = SIM_NO_EVENT;
+                return lateAlarmUs;
+            }
+
+            return alarmUs;
+        }
+
+    return SIM_NO_EVENT;
+}
+
+static void rtcFire(void)
+{
+    simRequireClocks("rtc", CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS, 0);
+    lateAlarmUs = 0;
+
+    // Edge triggered, the next event gets searched from the next second on
+    simRaiseIrq(RTC_IRQ);
+}
+
+static struct simEventSource rtcSource = {"rtc", rtcNextEvent, rtcFire};
+
+/// @brief Same as the irq handler of the sdk. Repeating alarms stay enabled.
+static void rtcIrqHandler(void)
+{
+    bool repeats = alarm.year < 0 || alarm.month < 0 || alarm.day < 0 || alarm.dotw < 0 ||
+                   alarm.hour < 0 || alarm.min < 0 || alarm.sec < 0;
+
+    rtc_disable_alarm();
+    if (repeats)
+        rtc_enable_alarm();
+
+    if (alarmCallback != NULL)
+        alarmCallback();
+}
+
+void simRtcInit(void)
+{
+    simAddEventSource(&rtcSource);
+}
+
+void rtc_init(void)
+{
+    running = false;
+    alarmEnabled = false;
+}
+
+bool rtc_set_datetime(datetime_t *t)
+{
+    if (t->year < 0 || t->year > 4095 ||
+        t->month < 1 || t->month > 12 ||
+        t->day < 1 || t->day > 31 ||
+        t->dotw < 0 || t->dotw > 6 ||
+        t->hour < 0 || t->hour > 23 ||
+        t->min < 0 || t->min > 59 ||
+        t->sec < 0 || t->sec > 59)
+        return false;
+
+    loadedEpoch = datetimeToEpoch(t);
+    loadedAtUs = simNow();
+    running = true;
+
+    if (!everLoaded)
+    {
+        everLoaded = true;
+        firstLoadOriginUs = loadedEpoch * 1000000 - (int64_t)loadedAtUs;
+    }
+
+    return true;
+}
+
+bool rtc_get_datetime(datetime_t *t)
+{
+    int64_t epoch;
+    if (!simRtcGetEpoch(&epoch))
+        return false;
+
+    epochToDatetime(epoch, t);
+    return true;
+}
+
+bool rtc_running(void)
+{
+    return running;
+}
+
+void rtc_set_alarm(datetime_t *t, rtc_callback_t user_callback)
+{
+    rtc_disable_alarm();
+
+    alarm = *t;
+    alarmCallback = user_callback;
+
+    irq_set_exclusive_handler(RTC_IRQ, rtcIrqHandler);
+    irq_set_enabled(RTC_IRQ, true);
+
+    rtc_enable_alarm();
+}
+
+void rtc_enable_alarm(void)
+{
+    alarmEnabled = true;
+}
+
+void rtc_disable_alarm(void)
+{
+    alarmEnabled = false;
+}
@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hardware/irq.h"
+#include "pico/stdlib.h"
+
+#include "Simulator.h"
+
+// Usb power and the virtual serial console. Usb power is connected from the start for the configured time
+// and the console input is "pasted" as soon as the firmware listens on the console. Like the usb irq of the sdk,
+// the usb irq calls the chars available callback once the input is there.
+//
+// With --sync-every usb gets connected every so often and the clock synced with SYNC TIME, with the exact real time
+// like a host tool with a perfect round trip would. The usb power goes away again after SYNC_USB_US.
+//
+// The replies to the commands the simulator types in itself get checked, an ERR means the scenario didn't run
+// as asked for and fails it.
+//
+// With --pty the console is a pseudo terminal a program on the host can talk to like to the real clock.
+// Virtual time is held back to real time then and the pty gets polled every PTY_POLL_US.
+
+#define USB_POWER_GPIO 24
+
+static bool usbPowered = false;
+static const char *pendingInput = NULL;
+
+static void (*charsAvailable)(void *) = NULL;
+static void *charsAvailableParam = NULL;
+
+#define PTY_POLL_US 250
+
+/// @brief Master side of the pty or -1.
+static int ptyFd = -1;
+
+/// @brief Host time (CLOCK_MONOTONIC) in ns at virtual time 0.
+static uint64_t ptyStartNs;
+
+static uint64_t ptyLastPoll = 0;
+
+/// @brief What came in from the pty and hasn't been read by the firmware yet.
+static char ptyInput[256];
+static uint32_t ptyInputStart = 0;
+static uint32_t ptyInputEnd = 0;
+
+/// @brief Where the console output goes, stdout gets replaced by a stream that looks at the replies first.
+static FILE *consoleOutput;
+
+/// @brief The pending input was made up by the simulator and its replies get checked.
+static bool inputChecked = false;
+
+/// @brief The last char read came from checked input, so the output is a reply to it.
+static bool replyChecked = false;
+
+/// @brief Start of the line that is being output, long enough to tell a reply.
+static char outputLine[4];
+static uint32_t outputLineLength = 0;
+
+static uint32_t rejectedLines = 0;
+
+static bool scriptPending(void)
+{
+    return pendingInput != NULL && *pendingInput != '\0';
+}
+
+static bool inputPending(void)
+{
+    return usbPowered && (scriptPending() || ptyInputStart < ptyInputEnd);
+}
+
+static void usbIrqHandler(void)
+{
+    if (charsAvailable != NULL && inputPending())
+        charsAvailable(charsAvailableParam);
+}
+
+static uint64_t powerNextEvent(void)
+{
+    return usbPowered ? simScenario.usbPowerUs : SIM_NO_EVENT;
+}
+
+static void powerFire(void)
+{
+    usbPowered = false;
+    simGpioSetInput(USB_POWER_GPIO, false);
+}
+
+static struct simEventSource powerSource = {"usb power", powerNextEvent, powerFire};
+
+static uint64_t hostNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t ptyNextEvent(void)
+{
+    return ptyLastPoll + PTY_POLL_US;
+}
+
+/// @brief Waits for real time to catch up with virtual time and takes what came in from the pty.
+static void ptyFire(void)
+{
+    ptyLastPoll = simNow();
+
+    uint64_t due = ptyStartNs + simNow() * 1000u;
+    uint64_t host = hostNs();
+    if (due > host)
+    {
+        struct timespec wait = {(due - host) / 1000000000u, (due - host) % 1000000000u};
+        nanosleep(&wait, NULL);
+    }
+
+    if (ptyInputStart == ptyInputEnd)
+        ptyInputStart = ptyInputEnd = 0;
+
+    ssize_t length = read(ptyFd, &ptyInput[ptyInputEnd], sizeof(ptyInput) - ptyInputEnd);
+    if (length > 0)
+    {
+        ptyInputEnd += length;
+        simRaiseIrq(USBCTRL_IRQ);
+    }
+    else if (length < 0 && errno != EAGAIN && errno != EIO)
+        simPanic("Reading the pty failed: %d", errno);
+}
+
+static struct simEventSource ptySource = {"pty", ptyNextEvent, ptyFire};
+
+/// @brief How long usb stays connected for a sync and how far ahead of the connection the rtc gets started at least.
+#define SYNC_USB_US 3000000
+#define SYNC_LEAD_US 500000
+
+static uint64_t nextSyncUs;
+static char syncInput[64];
+
+static uint64_t syncNextEvent(void)
+{
+    return simScenario.syncEveryUs != 0 ? nextSyncUs : SIM_NO_EVENT;
+}
+
+static void syncFire(void)
+{
+    nextSyncUs += simScenario.syncEveryUs;
+
+    int64_t wallTimeUs;
+    if (usbPowered || !simGetWallTimeUs(&wallTimeUs))
+        return;
+
+    // The start of a second at least SYNC_LEAD_US ahead, on the timer of the clock (which is the virtual time)
+    int64_t startSecond = (wallTimeUs + SYNC_LEAD_US) / 1000000 + 1;
+    uint64_t startAt = simNow() + (startSecond * 1000000 - wallTimeUs);
+
+    snprintf(syncInput, sizeof(syncInput), "SYNC TIME %lld %llu\n", (long long)startSecond, (unsigned long long)startAt);
+    pendingInput = syncInput;
+    inputChecked = true;
+
+    usbPowered = true;
+    simScenario.usbPowerUs = simNow() + SYNC_USB_US;
+    simGpioSetInput(USB_POWER_GPIO, true);
+}
+
+static struct simEventSource syncSource = {"sync", syncNextEvent, syncFire};
+
+/// @brief Opens the pty and sends the console output of the firmware to it.
+static void openPty(void)
+{
+    ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ptyFd < 0 || grantpt(ptyFd) != 0 || unlockpt(ptyFd) != 0)
+        simPanic("Opening a pty failed");
+
+    // Raw like a usb serial port: no echo and no line editing
+    struct termios attributes;
+    tcgetattr(ptyFd, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(ptyFd, TCSANOW, &attributes);
+    fcntl(ptyFd, F_SETFL, fcntl(ptyFd, F_GETFL) | O_NONBLOCK);
+
+    fflush(stdout);
+    dup2(ptyFd, STDOUT_FILENO);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    fprintf(stderr, "Console on %s\n", ptsname(ptyFd));
+    ptyStartNs = hostNs();
+    simAddEventSource(&ptySource);
+}
+
+/// @brief Passes the console output on and counts the ERR replies to checked input.
+static ssize_t consoleWrite(void *cookie, const char *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (buffer[i] == '\n')
+        {
+            outputLineLength = 0;
+            continue;
+        }
+
+        if (outputLineLength < sizeof(outputLine))
+            outputLine[outputLineLength++] = buffer[i];
+
+        if (outputLineLength == 3 && replyChecked && memcmp(outputLine, "ERR", 3) == 0)
+            rejectedLines++;
+    }
+
+    size_t written = fwrite(buffer, 1, size, consoleOutput);
+    fflush(consoleOutput);
+    return written;
+}
+
+/// @brief Number of lines typed in by the simulator that the firmware answered with ERR.
+uint32_t simStdioRejectedLines(void)
+{
+    return rejectedLines;
+}
+
+void simStdioInit(void)
+{
+    pendingInput = simScenario.consoleInput;
+    inputChecked = simScenario.checkConsoleReplies;
+
+    consoleOutput = stdout;
+    stdout = fopencookie(NULL, "w", (cookie_io_functions_t){.write = consoleWrite});
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (simScenario.usbPowerUs > 0)
+    {
+        usbPowered = true;
+        simGpioSetInput(USB_POWER_GPIO, true);
+    }
+
+    simAddEventSource(&powerSource);
+
+    nextSyncUs = simScenario.syncEveryUs;
+    simAddEventSource(&syncSource);
+
+    if (simScenario.pty)
+        openPty();
+}
+
+bool stdio_usb_init(void)
+{
+    simSetIrqHandler(USBCTRL_IRQ, usbIrqHandler);
+    simSetIrqEnabled(USBCTRL_IRQ, true);
+    return usbPowered;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param)
+{
+    charsAvailable = fn;
+    charsAvailableParam = param;
+
+    if (inputPending())
+        simRaiseIrq(USBCTRL_IRQ);
+}
+
+bool stdio_usb_connected(void)
+{
+    return usbPowered;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    if (inputPending())
+    {
+        replyChecked = scriptPending() && inputChecked;
+        return scriptPending() ? *pendingInput++ : ptyInput[ptyInputStart++];
+    }
+
+    simAdvanceBy(timeout_us);
+    return PICO_ERROR_TIMEOUT;
+}
+
+int putchar_raw(int c)
+{
+    return putchar(c);
+}
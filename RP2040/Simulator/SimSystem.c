@@ -0,0 +1,266 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pll.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/structs/scb.h"
+
+#include "Simulator.h"
+
+// Core, nvic, sleep and clock parts of the Pico SDK on top of the virtual time of the simulator.
+
+armv6m_scb_t simScb[2];
+
+/// @brief All clocks run during sleep after reset.
+clocks_hw_t simClocks = {0xffffffffu, 0x7fffu, 0xffffffffu, 0x7fffu};
+
+pll_hw_t simPllSys = {true, 125000000};
+pll_hw_t simPllUsb = {true, 48000000};
+
+/// @brief Frequencies of the clock generators, set up like the sdk does before main.
+static uint32_t clockHz[CLK_COUNT] = {
+    [clk_ref] = 12000000,
+    [clk_sys] = 125000000,
+    [clk_peri] = 125000000,
+    [clk_usb] = 48000000,
+    [clk_adc] = 48000000,
+    [clk_rtc] = 46875,
+};
+
+/// @brief clk_sys cycles up to the virtual time of the last change of clk_sys.
+static double sysCycles = 0;
+static uint64_t sysCyclesSince = 0;
+
+/// @brief Set while core 0 sleeps in wfi.
+static bool core0Sleeping = false;
+
+/// @brief Time both cores spent in deep sleep in us.
+static uint64_t deepSleepUs = 0;
+
+static void unhandledIrq(void)
+{
+    simPanic("Unhandled irq");
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    simSetIrqEnabled(num, enabled);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    irq_handler_t current = simGetIrqHandler(num);
+
+    // Same check as the sdk does with hard_assert
+    if (current != NULL && current != unhandledIrq && current != handler)
+        simPanic("irq_set_exclusive_handler: irq %u already has a different handler", num);
+
+    simSetIrqHandler(num, handler);
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num)
+{
+    irq_handler_t current = simGetIrqHandler(num);
+    return current == unhandledIrq ? NULL : current;
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler)
+{
+    if (simGetIrqHandler(num) == handler)
+        simSetIrqHandler(num, unhandledIrq);
+}
+
+/// @brief Both cores sleep with SLEEPDEEP set in their own scr, so the clocks block applies sleep_en0/1.
+static bool inDeepSleep(void)
+{
+    return core0Sleeping && !simInIrq() && (simScb[0].scr & M0PLUS_SCR_SLEEPDEEP_BITS) && simCore1Sleeping();
+}
+
+void __wfi(void)
+{
+    if (simOnCore1())
+    {
+        simCore1WaitForEvent();
+        return;
+    }
+
+    if (simInIrq())
+        simPanic("wfi inside an irq handler");
+
+    // With SLEEPONEXIT set the core goes back to sleep after every handler
+    // and only returns to thread mode once a handler cleared the bit
+    core0Sleeping = true;
+    do
+    {
+        bool deepSleep = inDeepSleep();
+        uint64_t since = simNow();
+        simWaitForEvent();
+        if (deepSleep)
+            deepSleepUs += simNow() - since;
+    } while (simScb[0].scr & M0PLUS_SCR_SLEEPONEXIT_BITS);
+    core0Sleeping = false;
+}
+
+void __wfe(void)
+{
+    if (simOnCore1())
+        simCore1WaitForEvent();
+    else
+        simWaitForEvent();
+}
+
+void __sev(void)
+{
+    simSendEvent();
+}
+
+/// @brief tight_loop_contents(). Core 0 spins until the next event, core 1 gives core 0 a chance to change what it waits for.
+void simSpin(void)
+{
+    if (simOnCore1())
+        simCore1SleepUntil(simNow() + 1);
+    else
+        simWaitForEvent();
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    uint32_t status = simGetInterruptsEnabled();
+    simSetInterruptsEnabled(false);
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    simSetInterruptsEnabled(status != 0);
+
+    // Irqs that became pending in the meantime get taken right away
+    if (!simInIrq())
+        simAdvanceBy(0);
+}
+
+void sleep_us(uint64_t us)
+{
+    if (simOnCore1())
+        simCore1SleepUntil(simNow() + us);
+    else
+        simAdvanceBy(us);
+}
+
+void busy_wait_until(absolute_time_t t)
+{
+    if (simOnCore1())
+        simCore1SleepUntil(to_us_since_boot(t));
+    else if (to_us_since_boot(t) > simNow())
+        simAdvanceTo(to_us_since_boot(t));
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000u);
+}
+
+/// @brief Checks that the given peripheral clocks run. They are gated while both cores are in deep sleep
+/// and not enabled in the sleep_en registers, hardware that does something in that state would silently stop.
+/// @param block Name of the hardware block for the panic message.
+void simRequireClocks(const char *block, uint32_t en0, uint32_t en1)
+{
+    if (!inDeepSleep())
+        return;
+
+    if ((simClocks.sleep_en0 & en0) != en0 || (simClocks.sleep_en1 & en1) != en1)
+        simPanic("%s is active in deep sleep but its clock is gated (sleep_en0 %08x sleep_en1 %08x)", block, simClocks.sleep_en0, simClocks.sleep_en1);
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+    return clockHz[clk_index];
+}
+
+/// @brief Time both cores spent in deep sleep with the clocks gated in us.
+uint64_t simDeepSleepTime(void)
+{
+    return deepSleepUs;
+}
+
+/// @brief Average frequency of clk_sys over the whole simulation in MHz.
+double simAverageSystemClock(void)
+{
+    if (simNow() == 0)
+        return clockHz[clk_sys] / 1e6;
+
+    double cycles = sysCycles + (double)clockHz[clk_sys] * (simNow() - sysCyclesSince) / 1e6;
+    return cycles / simNow();
+}
+
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq)
+{
+    if (freq > src_freq)
+        return false;
+
+    // clk_sys is the only clock the firmware moves, either onto clk_ref or back onto the pll
+    if (clk_index == clk_sys && src == CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX &&
+        auxsrc == CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS && !simPllSys.running)
+        simPanic("clk_sys switched onto pll_sys while the pll is stopped");
+
+    if (clk_index == clk_sys)
+    {
+        sysCycles += (double)clockHz[clk_sys] * (simNow() - sysCyclesSince) / 1e6;
+        sysCyclesSince = simNow();
+    }
+
+    clockHz[clk_index] = freq;
+    return true;
+}
+
+/// @brief Like the sdk: clk_sys moves onto clk_ref while pll_sys gets set up for the new frequency, clk_peri follows clk_sys.
+bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+    // Lowest frequency the pll can make: 750MHz vco divided by 7 and 7
+    if (freq_khz < 15306 || freq_khz > 133000)
+    {
+        if (required)
+            simPanic("System clock %ukHz is not possible", freq_khz);
+        return false;
+    }
+
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, clockHz[clk_ref], clockHz[clk_ref]);
+    pll_init(pll_sys, 1, freq_khz * 1000u * 12u, 6, 2);
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS, freq_khz * 1000u, freq_khz * 1000u);
+    clockHz[clk_peri] = freq_khz * 1000u;
+
+    return true;
+}
+
+void pll_init(PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2)
+{
+    pll->running = true;
+    pll->outputHz = vco_freq / (post_div1 * post_div2);
+
+    // Lock time of the pll
+    sleep_us(ref_div * 20);
+}
+
+void pll_deinit(PLL pll)
+{
+    if (pll == pll_sys && clockHz[clk_sys] > clockHz[clk_ref])
+        simPanic("pll_sys stopped while clk_sys still runs from it");
+
+    pll->running = false;
+}
+
+void panic(const char *fmt, ...)
+{
+    char message[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+
+    simPanic("%s", message);
+}
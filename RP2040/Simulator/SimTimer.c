@@ -0,0 +1,159 @@
+#include "hardware/irq.h"
+#include "hardware/structs/clocks.h"
+#include "hardware/timer.h"
+
+#include "Simulator.h"
+
+// Timer model: the four alarms of the 1 MHz timer. time_us_64() is the virtual time itself.
+
+static uint32_t claimedAlarms = 0;
+static bool armed[NUM_TIMERS];
+static uint64_t targets[NUM_TIMERS];
+static hardware_alarm_callback_t callbacks[NUM_TIMERS];
+
+static uint64_t timerNextEvent(void)
+{
+    uint64_t next = SIM_NO_EVENT;
+
+    for (uint alarm = 0; alarm < NUM_TIMERS; alarm++)
+        if (armed[alarm] && targets[alarm] < next)
+            next = targets[alarm];
+
+    return next;
+}
+
+static void timerFire(void)
+{
+    // The timer counts the ticks the watchdog generates from clk_ref
+    simRequireClocks("timer", 0, CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS);
+
+    for (uint alarm = 0; alarm < NUM_TIMERS; alarm++)
+    {
+        if (armed[alarm] && targets[alarm] <= simNow())
+        {
+            armed[alarm] = false;
+            simRaiseIrq(TIMER_IRQ_0 + alarm);
+        }
+    }
+}
+
+static struct simEventSource timerSource = {"timer", timerNextEvent, timerFire};
+
+/// @brief Same as the irq handler of the sdk, the alarm is disarmed before the callback gets called.
+static void alarmIrqHandler(uint alarm)
+{
+    armed[alarm] = false;
+
+    if (callbacks[alarm] != NULL)
+        callbacks[alarm](alarm);
+}
+
+static void alarm0IrqHandler(void)
+{
+    alarmIrqHandler(0);
+}
+
+static void alarm1IrqHandler(void)
+{
+    alarmIrqHandler(1);
+}
+
+static void alarm2IrqHandler(void)
+{
+    alarmIrqHandler(2);
+}
+
+static void alarm3IrqHandler(void)
+{
+    alarmIrqHandler(3);
+}
+
+static const irq_handler_t alarmIrqHandlers[NUM_TIMERS] = {alarm0IrqHandler, alarm1IrqHandler, alarm2IrqHandler, alarm3IrqHandler};
+
+void simTimerInit(void)
+{
+    simAddEventSource(&timerSource);
+
+    // Alarm 3 belongs to the default alarm pool of the sdk
+    claimedAlarms = 1u << 3;
+}
+
+uint64_t time_us_64(void)
+{
+    return simNow();
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)simNow();
+}
+
+void hardware_alarm_claim(uint alarm_num)
+{
+    if (claimedAlarms & (1u << alarm_num))
+        panic("Hardware alarm %u already claimed", alarm_num);
+
+    claimedAlarms |= 1u << alarm_num;
+}
+
+int hardware_alarm_claim_unused(bool required)
+{
+    for (uint alarm = 0; alarm < NUM_TIMERS; alarm++)
+    {
+        if ((claimedAlarms & (1u << alarm)) == 0)
+        {
+            claimedAlarms |= 1u << alarm;
+            return alarm;
+        }
+    }
+
+    if (required)
+        panic("No hardware alarms are available");
+
+    return -1;
+}
+
+void hardware_alarm_unclaim(uint alarm_num)
+{
+    claimedAlarms &= ~(1u << alarm_num);
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback)
+{
+    callbacks[alarm_num] = callback;
+
+    if (callback != NULL)
+    {
+        irq_set_exclusive_handler(TIMER_IRQ_0 + alarm_num, alarmIrqHandlers[alarm_num]);
+        irq_set_enabled(TIMER_IRQ_0 + alarm_num, true);
+    }
+    else
+    {
+        irq_set_enabled(TIMER_IRQ_0 + alarm_num, false);
+        irq_remove_handler(TIMER_IRQ_0 + alarm_num, alarmIrqHandlers[alarm_num]);
+    }
+}
+
+/// @return true when the target time has already passed, the alarm is not armed in that case.
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t)
+{
+    if (to_us_since_boot(t) <= simNow())
+    {
+        armed[alarm_num] = false;
+        return true;
+    }
+
+    targets[alarm_num] = to_us_since_boot(t);
+    armed[alarm_num] = true;
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num)
+{
+    armed[alarm_num] = false;
+}
+
+void hardware_alarm_force_irq(uint alarm_num)
+{
+    simRaiseIrq(TIMER_IRQ_0 + alarm_num);
+}
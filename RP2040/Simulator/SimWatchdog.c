@@ -0,0 +1,59 @@
+#include "hardware/watchdog.h"
+
+#include "Simulator.h"
+
+// Watchdog model: the counter runs down in virtual time from the last update while the enable bit is set
+// and resets the chip when it gets to zero. A reset restarts the simulator with the state that survives it.
+
+watchdog_hw_t simWatchdog;
+
+/// @brief Virtual time of the last reload of the counter.
+static uint64_t updatedAt = 0;
+
+/// @brief The counter runs down twice per tick (RP2040-E1), the load value is twice the timeout in us.
+static uint64_t timeoutUs(void)
+{
+    return simWatchdog.load / 2;
+}
+
+static uint64_t watchdogNextEvent(void)
+{
+    if ((simWatchdog.ctrl & WATCHDOG_CTRL_ENABLE_BITS) == 0)
+        return SIM_NO_EVENT;
+
+    return updatedAt + timeoutUs();
+}
+
+static void watchdogFire(void)
+{
+    simReset(WATCHDOG_REASON_TIMER_BITS);
+}
+
+static struct simEventSource watchdogSource = {"watchdog", watchdogNextEvent, watchdogFire};
+
+void simWatchdogInit(void)
+{
+    simAddEventSource(&watchdogSource);
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug)
+{
+    simWatchdog.ctrl &= ~WATCHDOG_CTRL_ENABLE_BITS;
+
+    if (pause_on_debug)
+        simWatchdog.ctrl |= WATCHDOG_CTRL_PAUSE_DBG0_BITS | WATCHDOG_CTRL_PAUSE_DBG1_BITS | WATCHDOG_CTRL_PAUSE_JTAG_BITS;
+
+    simWatchdog.load = delay_ms * 1000u * 2u;
+    watchdog_update();
+    simWatchdog.ctrl |= WATCHDOG_CTRL_ENABLE_BITS;
+}
+
+void watchdog_update(void)
+{
+    updatedAt = simNow();
+}
+
+bool watchdog_caused_reboot(void)
+{
+    return simWatchdog.reason != 0;
+}
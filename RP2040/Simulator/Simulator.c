@@ -0,0 +1,239 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Simulator.h"
+
+/// @brief Current virtual time in us since power on.
+static uint64_t now = 0;
+
+/// @brief All registered event sources.
+static struct simEventSource *eventSources = NULL;
+
+static void (*irqHandlers[SIM_IRQ_COUNT])(void);
+static uint32_t irqEnabledMask = 0;
+static uint32_t irqPendingMask = 0;
+static uint64_t irqRaisedAt[SIM_IRQ_COUNT];
+
+/// @brief Set while an irq handler is running. Handlers are not nested.
+static bool inIrq = false;
+
+/// @brief The irq whose handler runs while inIrq is set.
+static unsigned int runningIrq = 0;
+
+/// @brief Mirrors PRIMASK (save_and_disable_interrupts / restore_interrupts).
+static bool interruptsEnabled = true;
+
+struct simIrqStatistics simIrqStatistics[SIM_IRQ_COUNT];
+
+uint64_t simNow(void)
+{
+    return now;
+}
+
+void simAddEventSource(struct simEventSource *source)
+{
+    source->next = eventSources;
+    eventSources = source;
+}
+
+bool simInIrq(void)
+{
+    return inIrq;
+}
+
+uint __get_current_exception(void)
+{
+    return inIrq ? 16 + runningIrq : 0;
+}
+
+void simRaiseIrq(unsigned int irq)
+{
+    if ((irqPendingMask & (1u << irq)) == 0)
+        irqRaisedAt[irq] = now;
+
+    irqPendingMask |= 1u << irq;
+}
+
+void simSetIrqHandler(unsigned int irq, void (*handler)(void))
+{
+    irqHandlers[irq] = handler;
+}
+
+void (*simGetIrqHandler(unsigned int irq))(void)
+{
+    return irqHandlers[irq];
+}
+
+void simSetIrqEnabled(unsigned int irq, bool enabled)
+{
+    if (enabled)
+        irqEnabledMask |= 1u << irq;
+    else
+        irqEnabledMask &= ~(1u << irq);
+}
+
+void simSetInterruptsEnabled(bool enabled)
+{
+    interruptsEnabled = enabled;
+}
+
+bool simGetInterruptsEnabled(void)
+{
+    return interruptsEnabled;
+}
+
+static uint64_t hostNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/// @brief The handler that is about to run never returns. Time goes on for the hardware and core 1,
+/// only the watchdog gets the chip out of it.
+static void hang(void)
+{
+    inIrq = true;
+    simAdvanceTo(simScenario.endTimeUs);
+    simPanic("Stuck in an irq handler and the watchdog didn't reset the chip");
+}
+
+/// @brief Runs the handlers of all pending and enabled irqs, lowest irq number first like the NVIC does for equal priorities.
+/// @return true when at least one handler was run.
+static bool dispatchIrqs(void)
+{
+    bool dispatched = false;
+
+    while (!inIrq && interruptsEnabled && (irqPendingMask & irqEnabledMask) != 0)
+    {
+        unsigned int irq = __builtin_ctz(irqPendingMask & irqEnabledMask);
+        irqPendingMask &= ~(1u << irq);
+
+        if (irqHandlers[irq] == NULL)
+            simPanic("Unhandled irq %u", irq);
+
+        if (now >= simScenario.hangAtUs)
+            hang();
+
+        struct simIrqStatistics *stats = &simIrqStatistics[irq];
+        uint64_t latency = now - irqRaisedAt[irq];
+        uint64_t entry = now;
+
+        inIrq = true;
+        runningIrq = irq;
+        uint64_t hostStart = hostNs();
+        irqHandlers[irq]();
+        uint64_t hostTime = hostNs() - hostStart;
+        inIrq = false;
+
+        uint64_t busy = now - entry;
+        if (stats->count == 0 || hostTime < stats->hostNsMin)
+            stats->hostNsMin = hostTime;
+        if (hostTime > stats->hostNsMax)
+            stats->hostNsMax = hostTime;
+        if (busy > stats->busyUsMax)
+            stats->busyUsMax = busy;
+        if (latency > stats->latencyUsMax)
+            stats->latencyUsMax = latency;
+        stats->hostNsTotal += hostTime;
+        stats->busyUsTotal += busy;
+        stats->latencyUsTotal += latency;
+        stats->count++;
+
+        dispatched = true;
+    }
+
+    return dispatched;
+}
+
+/// @brief Finds the event source with the earliest event.
+static struct simEventSource *nextEventSource(uint64_t *time)
+{
+    struct simEventSource *earliest = NULL;
+    *time = SIM_NO_EVENT;
+
+    for (struct simEventSource *source = eventSources; source != NULL; source = source->next)
+    {
+        uint64_t t = source->nextEvent();
+        if (t < *time)
+        {
+            *time = t;
+            earliest = source;
+        }
+    }
+
+    return earliest;
+}
+
+/// @brief Lets virtual time pass up to the given time. Events that are due get fired and
+/// irqs they raise get handled unless we are already in an irq handler (busy waiting inside a handler).
+void simAdvanceTo(uint64_t timeUs)
+{
+    while (true)
+    {
+        dispatchIrqs();
+        simRunCore1();
+
+        uint64_t eventTime;
+        struct simEventSource *source = nextEventSource(&eventTime);
+        if (source == NULL || eventTime > timeUs)
+            break;
+
+        if (eventTime > now)
+            now = eventTime;
+
+        source->fire();
+    }
+
+    if (timeUs > now)
+        now = timeUs;
+
+    if (!inIrq && now >= simScenario.endTimeUs)
+        simFinish();
+}
+
+void simAdvanceBy(uint64_t us)
+{
+    simAdvanceTo(now + us);
+}
+
+/// @brief Lets virtual time pass until the next event happened and pending irqs got handled.
+/// This is what the core does in wfi or while spinning on a register.
+void simWaitForEvent(void)
+{
+    simRunCore1();
+
+    if (dispatchIrqs())
+        return;
+
+    // An irq that is only held off by PRIMASK still wakes the core
+    if (irqPendingMask & irqEnabledMask)
+        return;
+
+    uint64_t eventTime;
+    struct simEventSource *source = nextEventSource(&eventTime);
+    if (source == NULL || eventTime >= simScenario.endTimeUs)
+    {
+        if (inIrq)
+            simPanic("Waiting for an event that never happens inside an irq handler");
+
+        now = simScenario.endTimeUs;
+        simFinish();
+    }
+
+    simAdvanceTo(eventTime);
+}
+
+void simPanic(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "\nPANIC at %.6fs: ", now / 1e6);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+
+    exit(2);
+}
@@ -0,0 +1,192 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hardware/pio.h"
+
+/// @brief Returned by an event source when it has nothing scheduled.
+#define SIM_NO_EVENT UINT64_MAX
+
+/// @brief Something in the simulated hardware that does things at a point in virtual time
+/// (rtc alarm, pwm wrap, usb power change, ...).
+struct simEventSource
+{
+    /// @brief Name shown in the statistics.
+    const char *name;
+
+    /// @brief Returns the virtual time in us of the next event or SIM_NO_EVENT.
+    uint64_t (*nextEvent)(void);
+
+    /// @brief Performs the event that is due at the current virtual time.
+    void (*fire)(void);
+
+    /// @brief Next source in the list of registered sources.
+    struct simEventSource *next;
+};
+
+/// @brief Number of interrupt lines of the RP2040 NVIC.
+#define SIM_IRQ_COUNT 32
+
+/// @brief Statistics collected for every interrupt line.
+struct simIrqStatistics
+{
+    uint64_t count;
+
+    /// @brief Host cpu time spent in the handler in ns.
+    uint64_t hostNsTotal;
+    uint64_t hostNsMin;
+    uint64_t hostNsMax;
+
+    /// @brief Virtual time that passed while the handler was running in us (busy waits on the hardware).
+    uint64_t busyUsTotal;
+    uint64_t busyUsMax;
+
+    /// @brief Virtual time between the hardware raising the irq and the handler being entered in us.
+    uint64_t latencyUsTotal;
+    uint64_t latencyUsMax;
+};
+
+/// @brief Configuration of a simulation run, filled from the command line.
+struct simScenario
+{
+    /// @brief Virtual time at which the simulation ends in us.
+    uint64_t endTimeUs;
+
+    /// @brief How long usb power is connected after the start in us.
+    uint64_t usbPowerUs;
+
+    /// @brief What gets typed into the virtual serial console once it is connected.
+    const char *consoleInput;
+
+    /// @brief The console input was made up by the simulator, a reply that rejects it fails the run.
+    bool checkConsoleReplies;
+
+    /// @brief Print the console output of the firmware.
+    bool verbose;
+
+    /// @brief Virtual time from which on the next irq handler never returns or SIM_NO_EVENT.
+    uint64_t hangAtUs;
+
+    /// @brief Virtual time at which the power gets cut or SIM_NO_EVENT.
+    uint64_t powerCycleAtUs;
+
+    /// @brief Nobody connects usb once the power is back after a power cycle.
+    bool unattended;
+
+    /// @brief The console is a pty and the simulation runs in real time.
+    bool pty;
+
+    /// @brief How many ppb the rtc runs fast (slow when negative).
+    int64_t rtcPpb;
+
+    /// @brief Usb gets connected this often and the clock synced with SYNC TIME like the host tool would, 0 for never.
+    uint64_t syncEveryUs;
+
+    /// @brief The first rtc alarm from this virtual time on gets raised lateAlarmDelayUs late or SIM_NO_EVENT.
+    /// Alarms that would have come in the meantime don't, as when the irq was kept from being handled for that long.
+    uint64_t lateAlarmAtUs;
+    uint64_t lateAlarmDelayUs;
+
+    /// @brief Time zone set in the setup (tz database name) or NULL for none (UTC).
+    const char *zone;
+};
+
+extern struct simScenario simScenario;
+extern struct simIrqStatistics simIrqStatistics[SIM_IRQ_COUNT];
+
+// Simulator.c
+uint64_t simNow(void);
+void simAddEventSource(struct simEventSource *source);
+void simAdvanceTo(uint64_t timeUs);
+void simAdvanceBy(uint64_t us);
+void simWaitForEvent(void);
+bool simInIrq(void);
+void simRaiseIrq(unsigned int irq);
+void simSetIrqHandler(unsigned int irq, void (*handler)(void));
+void (*simGetIrqHandler(unsigned int irq))(void);
+void simSetIrqEnabled(unsigned int irq, bool enabled);
+void simSetInterruptsEnabled(bool enabled);
+bool simGetInterruptsEnabled(void);
+void simPanic(const char *format, ...);
+void simFinish(void);
+
+// SimulatorMain.c
+void simReset(uint32_t reason);
+bool simGetWallTimeUs(int64_t *wallTimeUs);
+
+// SimGPIO.c
+void simGpioInit(void);
+void simGpioSetInput(unsigned int gpio, bool level);
+void simGpioUpdateOutputs(void);
+double simGpioDrive(unsigned int gpio);
+
+// SimSystem.c
+void simRequireClocks(const char *block, uint32_t en0, uint32_t en1);
+uint64_t simDeepSleepTime(void);
+double simAverageSystemClock(void);
+
+// SimTimer.c
+void simTimerInit(void);
+
+// SimRTC.c
+void simRtcInit(void);
+bool simRtcGetEpoch(int64_t *epoch);
+bool simRtcGetEpochUs(int64_t *epochUs);
+bool simRtcGetFirstLoadOrigin(int64_t *originUs);
+
+// SimPWM.c
+void simPwmInit(void);
+double simPwmDuty(unsigned int gpio);
+
+// SimPIO.c
+void simPioInit(void);
+uint64_t simPioTxSpaceAt(PIO pio, unsigned int sm);
+void simPioPush(PIO pio, unsigned int sm, uint32_t data);
+bool simPioIsTxFifo(volatile void *address, PIO *pio, unsigned int *sm);
+uint64_t simPioFramesShown(void);
+uint32_t simPioPixel(unsigned int index);
+
+// SimDMA.c
+void simDmaInit(void);
+
+// SimMulticore.c
+void simMulticoreInit(void);
+void simRunCore1(void);
+bool simOnCore1(void);
+bool simCore1Sleeping(void);
+bool simCore1Stopped(void);
+void simCore1WaitForEvent(void);
+void simCore1SleepUntil(uint64_t timeUs);
+void simSendEvent(void);
+
+// SimStdio.c
+void simStdioInit(void);
+uint32_t simStdioRejectedLines(void);
+
+// SimFlash.c
+void simFlashInit(void);
+void simFlashSave(FILE *file);
+bool simFlashLoad(FILE *file);
+
+// SimWatchdog.c
+void simWatchdogInit(void);
+
+// SimClockHands.c
+void simClockHandsUpdate(void);
+int32_t simClockHandPosition(unsigned int hand);
+uint32_t simClockHandSkippedSteps(unsigned int hand);
+uint64_t simClockHandShortestStepInterval(unsigned int hand);
+uint64_t simClockHandStepWrites(void);
+uint64_t simClockHandSteps(void);
+double simClockHandAverageCurrent(unsigned int hand);
+double simClockHandEnergy(unsigned int hand);
+void simClockHandsSave(FILE *file);
+bool simClockHandsLoad(FILE *file);
+
+// TinyStepperClock.c, main() gets renamed by the simulator build
+int firmwareMain(void);
+
+#endif
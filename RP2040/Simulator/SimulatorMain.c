@@ -0,0 +1,629 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hardware/irq.h"
+#include "hardware/rtc.h"
+#include "hardware/watchdog.h"
+
+#include "Config.h"
+#include "EventLog.h"
+#include "Power.h"
+#include "RTC.h"
+#include "Simulator.h"
+#include "TimeZone.h"
+#include "Trace.h"
+#include "WorkQueue.h"
+
+// Runs the firmware against the simulated hardware in virtual time and checks that the
+// clock hands show the time of the rtc when the simulation ends.
+
+struct simScenario simScenario = {
+    .endTimeUs = 24ull * 3600 * 1000000,
+    .usbPowerUs = 10ull * 1000000,
+    .consoleInput = NULL,
+    .verbose = false,
+    .hangAtUs = SIM_NO_EVENT,
+    .powerCycleAtUs = SIM_NO_EVENT,
+    .lateAlarmAtUs = SIM_NO_EVENT,
+};
+
+/// @brief What survives a reset of the chip. A reset restarts the simulator process with it,
+/// so all state of the firmware and the simulated hardware starts over like on the chip.
+struct simResumeState
+{
+    /// @brief Virtual time of all runs before this one in us.
+    uint64_t elapsedUs;
+
+    uint32_t resets;
+
+    /// @brief The last reset was a power cycle. Only the flash and the clock hands survive those.
+    bool poweredOff;
+    uint32_t powerCycles;
+
+    /// @brief Real time (UTC) in us since 1970 at the start of this run, the rtc is set with it the first time.
+    bool wallTimeKnown;
+    int64_t wallTimeUs;
+
+    /// @brief Hours the hands got checked against the local time of --zone and how often they were wrong.
+    uint32_t zoneChecks;
+    uint32_t zoneCheckFailures;
+
+    /// @brief Lines the simulator typed in that the firmware rejected.
+    uint32_t rejectedLines;
+
+    uint32_t watchdogReason;
+    uint32_t watchdogScratch[8];
+};
+
+static struct simResumeState resumeState;
+
+/// @brief Command line of the simulator, restarted with it on a reset.
+static int argumentCount;
+static char **arguments;
+
+/// @brief Stdout of the simulator. Stdout of the process belongs to the virtual serial console of the firmware.
+static FILE *report;
+
+static struct timespec hostStart;
+
+static const char *irqNames[SIM_IRQ_COUNT] = {
+    [TIMER_IRQ_0] = "TIMER_IRQ_0",
+    [TIMER_IRQ_1] = "TIMER_IRQ_1",
+    [TIMER_IRQ_2] = "TIMER_IRQ_2",
+    [TIMER_IRQ_3] = "TIMER_IRQ_3",
+    [PWM_IRQ_WRAP] = "PWM_IRQ_WRAP",
+    [USBCTRL_IRQ] = "USBCTRL_IRQ",
+    [PIO0_IRQ_0] = "PIO0_IRQ_0",
+    [PIO0_IRQ_1] = "PIO0_IRQ_1",
+    [PIO1_IRQ_0] = "PIO1_IRQ_0",
+    [DMA_IRQ_0] = "DMA_IRQ_0",
+    [DMA_IRQ_1] = "DMA_IRQ_1",
+    [IO_IRQ_BANK0] = "IO_IRQ_BANK0",
+    [SIO_IRQ_PROC0] = "SIO_IRQ_PROC0",
+    [SIO_IRQ_PROC1] = "SIO_IRQ_PROC1",
+    [RTC_IRQ] = "RTC_IRQ",
+};
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --days N           Simulated time in days (default 1)\n"
+            "  --minutes N        Simulated time in minutes\n"
+            "  --usb SECONDS      How long usb power is connected after the start (default 10)\n"
+            "  --time TIME        Time typed into the setup, anything SET TIME takes (default 01.01.24 11:59)\n"
+            "  --animations S E   Enable the hourly animations from hour S to hour E (0 to 23)\n"
+            "  --input TEXT       Raw console commands instead of the generated setup (\\n for enter)\n"
+            "  --hang MINUTES     Get stuck in the first irq handler after the given time\n"
+            "  --power-cycle MINUTES  Cut the power at the given time, it comes back with usb connected\n"
+            "  --unattended       Usb stays disconnected when the power comes back after a power cycle\n"
+            "  --pty              Console on a pty for a program on the host, runs in real time (not with resets)\n"
+            "  --rtc-ppm PPM      Let the rtc run fast by PPM (slow when negative)\n"
+            "  --sync-every MINUTES  Connect usb and sync the clock with SYNC TIME like the host tool would\n"
+            "  --zone NAME        Set the time zone in the setup and check the hands against the tz database of the host every hour\n"
+            "  --late-alarm MINUTES SECONDS  Raise the first rtc alarm after the given time late, a minute or more loses alarms\n"
+            "  --verbose          Show the console output of the firmware\n",
+            name);
+}
+
+/// @brief Parses an hour of --animations, 0 to 23 with or without a leading zero.
+static bool parseHour(const char *text, long *hour)
+{
+    char *end;
+    *hour = strtol(text, &end, 10);
+    return *text != '\0' && *end == '\0' && *hour >= 0 && *hour <= 23;
+}
+
+/// @brief Replaces \n in command line arguments with real line breaks.
+static char *unescape(const char *text)
+{
+    char *result = malloc(strlen(text) + 1);
+    char *out = result;
+
+    for (const char *in = text; *in != '\0'; in++)
+    {
+        if (in[0] == '\\' && in[1] == 'n')
+        {
+            *out++ = '\n';
+            in++;
+        }
+        else
+            *out++ = *in;
+    }
+
+    *out = '\0';
+    return result;
+}
+
+/// @brief Picks up what survived the reset that restarted the simulator. Ram that isn't cleared at boot keeps the event log.
+static void loadResumeState(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL ||
+        fread(&resumeState, sizeof(resumeState), 1, file) != 1 ||
+        fread(&eventLog, sizeof(eventLog), 1, file) != 1 ||
+        !simFlashLoad(file) ||
+        !simClockHandsLoad(file))
+    {
+        fprintf(stderr, "Can't read the resume state %s\n", path);
+        exit(2);
+    }
+
+    fclose(file);
+    remove(path);
+
+    simWatchdog.reason = resumeState.watchdogReason;
+    for (unsigned int i = 0; i < count_of(resumeState.watchdogScratch); i++)
+        simWatchdog.scratch[i] = resumeState.watchdogScratch[i];
+}
+
+/// @brief Moves an event of the scenario into the time of the run after a reset, events that already happened don't happen again.
+static uint64_t laterEvent(uint64_t timeUs, uint64_t elapsedUs)
+{
+    return timeUs != SIM_NO_EVENT && timeUs > elapsedUs ? timeUs - elapsedUs : SIM_NO_EVENT;
+}
+
+static void parseArguments(int argc, char **argv)
+{
+    const char *time = "01.01.24 11:59";
+    long animationStart = -1;
+    long animationEnd = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--days") == 0 && hasValue)
+            simScenario.endTimeUs = strtoull(argv[++i], NULL, 10) * 24 * 3600 * 1000000;
+        else if (strcmp(argv[i], "--minutes") == 0 && hasValue)
+            simScenario.endTimeUs = strtoull(argv[++i], NULL, 10) * 60 * 1000000;
+        else if (strcmp(argv[i], "--usb") == 0 && hasValue)
+            simScenario.usbPowerUs = strtoull(argv[++i], NULL, 10) * 1000000;
+        else if (strcmp(argv[i], "--time") == 0 && hasValue)
+            time = argv[++i];
+        else if (strcmp(argv[i], "--animations") == 0 && i + 2 < argc &&
+                 parseHour(argv[i + 1], &animationStart) && parseHour(argv[i + 2], &animationEnd))
+            i += 2;
+        else if (strcmp(argv[i], "--input") == 0 && hasValue)
+            simScenario.consoleInput = unescape(argv[++i]);
+        else if (strcmp(argv[i], "--hang") == 0 && hasValue)
+            simScenario.hangAtUs = strtoull(argv[++i], NULL, 10) * 60 * 1000000;
+        else if (strcmp(argv[i], "--power-cycle") == 0 && hasValue)
+            simScenario.powerCycleAtUs = strtoull(argv[++i], NULL, 10) * 60 * 1000000;
+        else if (strcmp(argv[i], "--unattended") == 0)
+            simScenario.unattended = true;
+        else if (strcmp(argv[i], "--pty") == 0)
+            simScenario.pty = true;
+        else if (strcmp(argv[i], "--rtc-ppm") == 0 && hasValue)
+            simScenario.rtcPpb = llround(strtod(argv[++i], NULL) * 1000);
+        else if (strcmp(argv[i], "--sync-every") == 0 && hasValue)
+            simScenario.syncEveryUs = strtoull(argv[++i], NULL, 10) * 60 * 1000000;
+        else if (strcmp(argv[i], "--late-alarm") == 0 && i + 2 < argc)
+        {
+            simScenario.lateAlarmAtUs = strtoull(argv[++i], NULL, 10) * 60 * 1000000;
+            simScenario.lateAlarmDelayUs = strtoull(argv[++i], NULL, 10) * 1000000;
+        }
+        else if (strcmp(argv[i], "--zone") == 0 && hasValue)
+            simScenario.zone = argv[++i];
+        else if (strcmp(argv[i], "--resume") == 0 && hasValue)
+            loadResumeState(argv[++i]);
+        else if (strcmp(argv[i], "--verbose") == 0)
+            simScenario.verbose = true;
+        else
+        {
+            printUsage(argv[0]);
+            exit(2);
+        }
+    }
+
+    // The hands get checked against the tz database of the host, the firmware has its own tables
+    if (simScenario.zone != NULL)
+    {
+        if (timeZoneFind(simScenario.zone) < 0)
+        {
+            fprintf(stderr, "The firmware doesn't know the zone %s\n", simScenario.zone);
+            exit(2);
+        }
+
+        setenv("TZ", simScenario.zone, 1);
+        tzset();
+    }
+
+    // A reset restarts the process, the program on the other end of the pty would lose it
+    if (simScenario.pty)
+    {
+        if (simScenario.hangAtUs != SIM_NO_EVENT || simScenario.powerCycleAtUs != SIM_NO_EVENT)
+        {
+            printUsage(argv[0]);
+            exit(2);
+        }
+
+        // The clock is compared against the time of the host
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        simScenario.usbPowerUs = SIM_NO_EVENT;
+        resumeState.wallTimeKnown = true;
+        resumeState.wallTimeUs = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    }
+
+    // The scenario goes on after a reset. After a watchdog reset nobody types anything into the console again,
+    // after a power cycle usb gets connected and the time gets set again (unless unattended).
+    // The hands shouldn't need to be homed and the settings are kept in flash
+    if (resumeState.resets > 0)
+    {
+        simScenario.endTimeUs = simScenario.endTimeUs > resumeState.elapsedUs ? simScenario.endTimeUs - resumeState.elapsedUs : 0;
+        simScenario.hangAtUs = laterEvent(simScenario.hangAtUs, resumeState.elapsedUs);
+        simScenario.powerCycleAtUs = laterEvent(simScenario.powerCycleAtUs, resumeState.elapsedUs);
+        simScenario.lateAlarmAtUs = laterEvent(simScenario.lateAlarmAtUs, resumeState.elapsedUs);
+
+        if (!resumeState.poweredOff)
+        {
+            simScenario.usbPowerUs = simScenario.usbPowerUs > resumeState.elapsedUs ? simScenario.usbPowerUs - resumeState.elapsedUs : 0;
+            simScenario.consoleInput = "";
+        }
+        else if (simScenario.unattended)
+        {
+            simScenario.usbPowerUs = 0;
+            simScenario.consoleInput = "";
+        }
+        else if (resumeState.wallTimeKnown)
+        {
+            // The console takes commands half a second after the power is back, the time is sent to the second (unix time)
+            char *input = malloc(128);
+            snprintf(input, 128, "SET TIME %lld\n", (long long)((resumeState.wallTimeUs + 500000) / 1000000));
+
+            simScenario.consoleInput = input;
+            simScenario.checkConsoleReplies = true;
+        }
+    }
+
+    if (simScenario.consoleInput == NULL)
+    {
+        // The hands start at 12 o'clock, so they only need to be marked as homed
+        char *input = malloc(256);
+        char animations[64] = "";
+        char zone[64] = "";
+        if (animationStart >= 0)
+            snprintf(animations, sizeof(animations), "SET ANIM ON %02ld %02ld\n", animationStart, animationEnd);
+        if (simScenario.zone != NULL)
+            snprintf(zone, sizeof(zone), "SET ZONE %s\n", simScenario.zone);
+
+        snprintf(input, 256, "%s%sHOME\nSET TIME %s\nSTATUS\n", animations, zone, time);
+
+        simScenario.consoleInput = input;
+        simScenario.checkConsoleReplies = true;
+    }
+}
+
+static void printIrqStatistics(void)
+{
+    fprintf(report, "%-14s %10s %26s %26s %22s\n", "irq", "count", "host ns min/avg/max", "busy us avg/max", "latency us avg/max");
+
+    for (unsigned int irq = 0; irq < SIM_IRQ_COUNT; irq++)
+    {
+        struct simIrqStatistics *stats = &simIrqStatistics[irq];
+        if (stats->count == 0)
+            continue;
+
+        char name[16];
+        if (irqNames[irq] != NULL)
+            snprintf(name, sizeof(name), "%s", irqNames[irq]);
+        else
+            snprintf(name, sizeof(name), "IRQ %u", irq);
+
+        fprintf(report, "%-14s %10llu %8llu/%8llu/%8llu %12.1f/%12llu %10.1f/%10llu\n",
+                name,
+                (unsigned long long)stats->count,
+                (unsigned long long)stats->hostNsMin,
+                (unsigned long long)(stats->hostNsTotal / stats->count),
+                (unsigned long long)stats->hostNsMax,
+                (double)stats->busyUsTotal / stats->count,
+                (unsigned long long)stats->busyUsMax,
+                (double)stats->latencyUsTotal / stats->count,
+                (unsigned long long)stats->latencyUsMax);
+    }
+}
+
+/// @brief How far the rtc may be off the real time at the end in seconds, without its drift.
+#define RTC_TOLERANCE_S 1.5
+
+/// @brief Prints the report and ends the simulation. The exit code tells whether the hands show the right time.
+void simFinish(void)
+{
+    // The report calls into the firmware, which can let time pass again
+    static bool finishing = false;
+    if (finishing)
+        return;
+    finishing = true;
+
+    fflush(stdout);
+
+    struct timespec hostEnd;
+    clock_gettime(CLOCK_MONOTONIC, &hostEnd);
+    double hostSeconds = (hostEnd.tv_sec - hostStart.tv_sec) + (hostEnd.tv_nsec - hostStart.tv_nsec) / 1e9;
+    double virtualSeconds = (resumeState.elapsedUs + simNow()) / 1e6;
+
+    fprintf(report, "\nSimulated %.0fs in %.3fs (%.0fx real time)\n\n", virtualSeconds, hostSeconds, virtualSeconds / hostSeconds);
+    printIrqStatistics();
+    fprintf(report, "\nLed frames shown: %llu\n", (unsigned long long)simPioFramesShown());
+
+    int32_t hourPosition = simClockHandPosition(0);
+    int32_t minutePosition = simClockHandPosition(1);
+    uint32_t skippedSteps = simClockHandSkippedSteps(0) + simClockHandSkippedSteps(1);
+    fprintf(report, "Hand positions: hour %d minute %d (skipped steps %u)\n", hourPosition, minutePosition, skippedSteps);
+    fprintf(report, "Fastest steps: hour %lluus minute %lluus apart\n",
+            (unsigned long long)simClockHandShortestStepInterval(0), (unsigned long long)simClockHandShortestStepInterval(1));
+    fprintf(report, "Stepper writes: %llu for %llu steps\n",
+            (unsigned long long)simClockHandStepWrites(), (unsigned long long)simClockHandSteps());
+    fprintf(report, "Coil current: hour %.2fmA minute %.2fmA average, %.1fJ in total\n",
+            simClockHandAverageCurrent(0), simClockHandAverageCurrent(1), simClockHandEnergy(0) + simClockHandEnergy(1));
+
+    fprintf(report, "Power states:");
+    for (uint32_t state = 0; state < POWER_STATE_COUNT; state++)
+        fprintf(report, " %s %.1fs", powerGetStateName(state), powerGetTimeInState(state) / 1e6);
+    fprintf(report, "\n");
+    fprintf(report, "Deep sleep: %.1fs (%.1f%%)\n", simDeepSleepTime() / 1e6, 100.0 * simDeepSleepTime() / MAX(simNow(), 1));
+    fprintf(report, "System clock: %.2fMHz average\n", simAverageSystemClock());
+    fprintf(report, "Deferred work: %lluus longest wait\n", (unsigned long long)workQueueGetMaxDelay());
+    fprintf(report, "Event log: %lu events written, %lu kept\n", (unsigned long)eventLog.head, (unsigned long)eventLogGetCount());
+
+#if TRACE_ENABLED
+    // The firmware prints the trace to its console, which goes to the report from here on
+    fprintf(report, "\nFirmware trace:\n");
+    fflush(report);
+    fflush(stdout);
+    dup2(fileno(report), STDOUT_FILENO);
+    traceDump();
+    fflush(stdout);
+    fprintf(report, "\n");
+#endif
+
+    struct rtcAlarmStatistics alarms;
+    rtcGetAlarmStatistics(&alarms);
+    fprintf(report, "Rtc alarms: %lu late (latest %.3fs), %lu minutes missed, %lu catch-ups\n", (unsigned long)alarms.late,
+            alarms.maxLateUs / 1e6, (unsigned long)alarms.missed, (unsigned long)alarms.catchUps);
+
+    if (simScenario.rtcPpb != 0 || simScenario.syncEveryUs != 0)
+        fprintf(report, "Rtc drift: %.3fppm fast, trim %ldppb learned\n", simScenario.rtcPpb / 1e3, (long)config.rtcTrimPpb);
+
+    // The rtc keeps the real time over resets up to a second, plus what it drifted unless it got synced.
+    // On a pty it is whatever got typed in, how far that is from the time of the computer is only shown.
+    int64_t rtcEpochUs;
+    int64_t wallTimeUs;
+    bool rtcOff = false;
+    if (resumeState.resets > 0 && !rtcIsTimeSet())
+    {
+        fprintf(report, "Resets: %u (%u power cycles), rtc runs from the time the hands showed\n", resumeState.resets, resumeState.powerCycles);
+    }
+    else if (simGetWallTimeUs(&wallTimeUs) && simRtcGetEpochUs(&rtcEpochUs))
+    {
+        double behind = (wallTimeUs - rtcEpochUs) / 1e6;
+        double tolerance = RTC_TOLERANCE_S + fabs(simScenario.rtcPpb / 1e9) * virtualSeconds;
+        rtcOff = !simScenario.pty && fabs(behind) > tolerance;
+        fprintf(report, "Resets: %u (%u power cycles), rtc %.3fs behind%s\n", resumeState.resets, resumeState.powerCycles, behind,
+                rtcOff ? ", more than it may be" : "");
+    }
+
+    if (simScenario.zone != NULL)
+        fprintf(report, "Zone %s: %u hours checked against the tz database of the host, %u wrong\n",
+                simScenario.zone, resumeState.zoneChecks, resumeState.zoneCheckFailures);
+
+    uint32_t rejectedLines = resumeState.rejectedLines + simStdioRejectedLines();
+    if (rejectedLines != 0)
+        fprintf(report, "Console: %u lines of the scenario rejected\n", rejectedLines);
+
+    datetime_t t;
+    if (!rtcGetLocalTime(&t))
+    {
+        fprintf(report, "FAIL: rtc was never started\n");
+        exit(1);
+    }
+
+    int32_t expectedHour = (t.hour % 12) * 5 + t.min / 12;
+    int32_t expectedMinute = t.min;
+    fprintf(report, "Local time: %04d-%02d-%02d %02d:%02d:%02d expects hour %d minute %d\n",
+            t.year, t.month, t.day, t.hour, t.min, t.sec, expectedHour, expectedMinute);
+
+    if (hourPosition != expectedHour || minutePosition != expectedMinute || skippedSteps != 0 || resumeState.zoneCheckFailures != 0 ||
+        rejectedLines != 0 || rtcOff)
+    {
+        fprintf(report, "FAIL\n");
+        exit(1);
+    }
+
+    fprintf(report, "PASS\n");
+    exit(0);
+}
+
+/// @brief How long the power is off on a power cycle in us.
+#define POWER_OFF_US 2500000
+
+/// @brief Restarts the simulator process with what survives the reset and carries on with the scenario.
+/// @param reason The bits the reason register of the watchdog shows after the reset.
+/// @param powerOff Set when the power got cut, only the flash and the clock hands survive that.
+static void restart(uint32_t reason, bool powerOff)
+{
+    // From the second reset on the rtc might already be behind, real time goes on from when the rtc was first set
+    int64_t wallTimeUs;
+    if (simGetWallTimeUs(&wallTimeUs))
+    {
+        resumeState.wallTimeKnown = true;
+        resumeState.wallTimeUs = wallTimeUs;
+    }
+
+    resumeState.elapsedUs += simNow();
+    resumeState.rejectedLines += simStdioRejectedLines();
+
+    // The power stays off for a moment, nothing runs meanwhile
+    if (powerOff)
+    {
+        resumeState.elapsedUs += POWER_OFF_US;
+        resumeState.wallTimeUs += POWER_OFF_US;
+    }
+
+    resumeState.resets++;
+    resumeState.poweredOff = powerOff;
+    resumeState.powerCycles += powerOff;
+    resumeState.watchdogReason = reason;
+    for (unsigned int i = 0; i < count_of(resumeState.watchdogScratch); i++)
+        resumeState.watchdogScratch[i] = powerOff ? 0 : simWatchdog.scratch[i];
+
+    // The ram doesn't hold anything useful once the power was off
+    if (powerOff)
+        memset(&eventLog, 0, sizeof(eventLog));
+
+    char path[] = "/tmp/TinyStepperClockSimulatorXXXXXX";
+    int fd = mkstemp(path);
+    FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (file == NULL)
+        simPanic("Can't write the resume state");
+
+    fwrite(&resumeState, sizeof(resumeState), 1, file);
+    fwrite(&eventLog, sizeof(eventLog), 1, file);
+    simFlashSave(file);
+    simClockHandsSave(file);
+    fclose(file);
+
+    fprintf(report, "%s at %.6fs\n", powerOff ? "Power cycle" : "Watchdog reset", resumeState.elapsedUs / 1e6);
+
+    // Same command line without the state of an earlier reset
+    char **argv = malloc((argumentCount + 3) * sizeof(char *));
+    int argc = 0;
+    for (int i = 0; i < argumentCount; i++)
+    {
+        if (strcmp(arguments[i], "--resume") == 0 && i + 1 < argumentCount)
+            i++;
+        else
+            argv[argc++] = arguments[i];
+    }
+    argv[argc++] = "--resume";
+    argv[argc++] = path;
+    argv[argc] = NULL;
+
+    fflush(stdout);
+    fflush(report);
+    dup2(fileno(report), STDOUT_FILENO);
+    execv("/proc/self/exe", argv);
+
+    simPanic("Can't restart the simulator");
+}
+
+/// @brief The real time at the current virtual time in us, the time the rtc got set to first and the time that passed since.
+/// @return false when the rtc hasn't been set yet.
+bool simGetWallTimeUs(int64_t *wallTimeUs)
+{
+    int64_t originUs;
+    if (resumeState.wallTimeKnown)
+        *wallTimeUs = resumeState.wallTimeUs + (int64_t)simNow();
+    else if (simRtcGetFirstLoadOrigin(&originUs))
+        *wallTimeUs = originUs + (int64_t)simNow();
+    else
+        return false;
+
+    return true;
+}
+
+/// @brief Resets the chip. Only the watchdog scratch registers, the uninitialized ram, the flash and the clock hands survive.
+/// @param reason The bits the reason register of the watchdog shows after the reset.
+void simReset(uint32_t reason)
+{
+    restart(reason, false);
+}
+
+static uint64_t powerCycleNextEvent(void)
+{
+    return simScenario.powerCycleAtUs;
+}
+
+static void powerCycleFire(void)
+{
+    restart(0, true);
+}
+
+static struct simEventSource powerCycleSource = {"power cycle", powerCycleNextEvent, powerCycleFire};
+
+/// @brief Virtual time of the next check of the hands against --zone.
+static uint64_t zoneCheckAtUs = 3600ull * 1000000;
+
+static uint64_t zoneCheckNextEvent(void)
+{
+    return simScenario.zone != NULL ? zoneCheckAtUs : SIM_NO_EVENT;
+}
+
+/// @brief Compares the hands with the local time the C library of the host works out from the time of the rtc.
+/// Half a minute after the step, a seek after a change of the offset is long done by then. How far the rtc is
+/// off (a watchdog reset, drift) doesn't matter here, it's the conversion to local time that gets checked.
+static void zoneCheckFire(void)
+{
+    int64_t rtcEpochUs;
+    if (!simRtcGetEpochUs(&rtcEpochUs))
+    {
+        zoneCheckAtUs = simNow() + 60000000;
+        return;
+    }
+
+    zoneCheckAtUs = simNow() + 3600ull * 1000000 - (rtcEpochUs % 60000000) + 30000000;
+
+    // Until the time is set the hands show whatever time the rtc got from them
+    if (!rtcIsTimeSet() || rtcEpochUs % 60000000 < 20000000 || rtcEpochUs % 60000000 > 40000000)
+        return;
+
+    time_t rtcTime = rtcEpochUs / 1000000;
+    struct tm local;
+    localtime_r(&rtcTime, &local);
+
+    int32_t expectedHour = (local.tm_hour % 12) * 5 + local.tm_min / 12;
+    int32_t expectedMinute = local.tm_min;
+    int32_t hour = simClockHandPosition(0);
+    int32_t minute = simClockHandPosition(1);
+
+    resumeState.zoneChecks++;
+    if (hour != expectedHour || minute != expectedMinute)
+    {
+        if (resumeState.zoneCheckFailures++ < 10)
+        {
+            char shown[32];
+            strftime(shown, sizeof(shown), "%Y-%m-%d %H:%M:%S %Z", &local);
+            fprintf(report, "Zone check at %s: hands at hour %d minute %d, expected %d %d\n",
+                    shown, hour, minute, expectedHour, expectedMinute);
+        }
+    }
+}
+
+static struct simEventSource zoneCheckSource = {"zone check", zoneCheckNextEvent, zoneCheckFire};
+
+int main(int argc, char **argv)
+{
+    argumentCount = argc;
+    arguments = argv;
+    parseArguments(argc, argv);
+
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(report, NULL, _IOLBF, 0);
+    if (!simScenario.verbose)
+        freopen("/dev/null", "w", stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &hostStart);
+
+    simGpioInit();
+    simTimerInit();
+    simRtcInit();
+    simPwmInit();
+    simPioInit();
+    simDmaInit();
+    simMulticoreInit();
+    simStdioInit();
+    simWatchdogInit();
+    simFlashInit();
+    simAddEventSource(&powerCycleSource);
+    simAddEventSource(&zoneCheckSource);
+
+    firmwareMain();
+
+    simPanic("main returned");
+}
@@ -0,0 +1,53 @@
+#ifndef STEPGENERATOR_PIO_H
+#define STEPGENERATOR_PIO_H
+
+// Stand-in for the header pioasm generates from StepGenerator.pio.
+// The simulator recognises the program by its instructions and models its timing.
+
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+
+#define step_generator_wrap_target 0
+#define step_generator_wrap 5
+
+static const uint16_t step_generator_program_instructions[] = {
+    0x6037, //  0: out    x, 23
+    0x0041, //  1: jmp    x--, 1
+    0x6008, //  2: out    pins, 8
+    0x6041, //  3: out    y, 1
+    0x0060, //  4: jmp    !y, 0
+    0xc000, //  5: irq    nowait 0
+};
+
+static const pio_program_t step_generator_program = {
+    .instructions = step_generator_program_instructions,
+    .length = 6,
+    .origin = -1,
+};
+
+static inline pio_sm_config step_generator_program_get_default_config(uint offset)
+{
+    pio_sm_config c = pio_get_default_sm_config();
+    return c;
+}
+
+/// @brief Cycles the program takes per word on top of the delay.
+#define step_generator_overhead_cycles 5
+
+static inline void step_generator_program_init(PIO pio, uint sm, uint offset, uint pin, uint pin_count, float freq)
+{
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, pin_count, true);
+
+    pio_sm_config c = step_generator_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin, pin_count);
+    sm_config_set_out_shift(&c, true, true, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+
+    float div = clock_get_hz(clk_sys) / freq;
+    sm_config_set_clkdiv(&c, div);
+
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif
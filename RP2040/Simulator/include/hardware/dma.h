@@ -0,0 +1,84 @@
+#ifndef _HARDWARE_DMA_H
+#define _HARDWARE_DMA_H
+
+#include "pico.h"
+
+#define NUM_DMA_CHANNELS 12
+
+#define DREQ_FORCE 0x3f
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct
+{
+    enum dma_channel_transfer_size size;
+    bool readIncrement;
+    bool writeIncrement;
+    uint dreq;
+} dma_channel_config;
+
+typedef struct
+{
+    const volatile void *readAddr;
+    volatile void *writeAddr;
+    uint32_t transferCount;
+    dma_channel_config config;
+    bool busy;
+} sim_dma_channel_t;
+
+typedef struct
+{
+    sim_dma_channel_t ch[NUM_DMA_CHANNELS];
+    uint32_t intr;
+    uint32_t inte0;
+    uint32_t ints0;
+    uint32_t inte1;
+    uint32_t ints1;
+} dma_hw_t;
+
+extern dma_hw_t simDma;
+#define dma_hw (&simDma)
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    dma_channel_config c = {DMA_SIZE_32, true, false, DREQ_FORCE};
+    return c;
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->readIncrement = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->writeIncrement = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_acknowledge_irq0(uint channel);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef _HARDWARE_PIO_H
+#define _HARDWARE_PIO_H
+
+#include "pico.h"
+#include "hardware/gpio.h"
+
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct
+{
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct
+{
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+/// @brief Simulated state machine. The simulator models what the loaded program does
+/// instead of executing the pio instructions.
+typedef struct
+{
+    const pio_program_t *program;
+    pio_sm_config config;
+    bool enabled;
+    uint pinBase;
+    uint pinCount;
+} sim_pio_sm_t;
+
+typedef struct
+{
+    uint index;
+    uint32_t txf[NUM_PIO_STATE_MACHINES];
+    const pio_program_t *programs[32];
+    uint32_t usedInstructions;
+    sim_pio_sm_t sm[NUM_PIO_STATE_MACHINES];
+
+    /// @brief Levels the state machines drive onto the pins that are given to this pio.
+    uint32_t pinValues;
+
+    uint32_t irq;
+    uint32_t inte0;
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t simPio0;
+extern pio_hw_t simPio1;
+#define pio0 (&simPio0)
+#define pio1 (&simPio1)
+
+enum pio_fifo_join
+{
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+enum pio_interrupt_source
+{
+    pis_interrupt0 = 8,
+    pis_interrupt1 = 9,
+    pis_interrupt2 = 10,
+    pis_interrupt3 = 11,
+};
+
+#define PIO_SM_CLKDIV_INT_LSB 16
+#define PIO_SM_SHIFTCTRL_FJOIN_TX_BITS 0x40000000u
+#define PIO_SM_SHIFTCTRL_PULL_THRESH_LSB 25
+#define PIO_SM_SHIFTCTRL_AUTOPULL_BITS 0x00020000u
+#define PIO_SM_SHIFTCTRL_OUT_SHIFTDIR_BITS 0x00080000u
+#define PIO_SM_PINCTRL_OUT_BASE_LSB 0
+#define PIO_SM_PINCTRL_SIDESET_BASE_LSB 10
+#define PIO_SM_PINCTRL_OUT_COUNT_LSB 20
+
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count)
+{
+    c->pinctrl = (c->pinctrl & ~((0x1fu << PIO_SM_PINCTRL_OUT_BASE_LSB) | (0x3fu << PIO_SM_PINCTRL_OUT_COUNT_LSB))) |
+                 (out_base << PIO_SM_PINCTRL_OUT_BASE_LSB) |
+                 (out_count << PIO_SM_PINCTRL_OUT_COUNT_LSB);
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base)
+{
+    c->pinctrl = (c->pinctrl & ~(0x1fu << PIO_SM_PINCTRL_SIDESET_BASE_LSB)) | (sideset_base << PIO_SM_PINCTRL_SIDESET_BASE_LSB);
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    c->shiftctrl = (c->shiftctrl & ~(PIO_SM_SHIFTCTRL_OUT_SHIFTDIR_BITS | PIO_SM_SHIFTCTRL_AUTOPULL_BITS | (0x1fu << PIO_SM_SHIFTCTRL_PULL_THRESH_LSB))) |
+                   (shift_right ? PIO_SM_SHIFTCTRL_OUT_SHIFTDIR_BITS : 0) |
+                   (autopull ? PIO_SM_SHIFTCTRL_AUTOPULL_BITS : 0) |
+                   ((pull_threshold & 0x1fu) << PIO_SM_SHIFTCTRL_PULL_THRESH_LSB);
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join)
+{
+    c->shiftctrl = (c->shiftctrl & ~PIO_SM_SHIFTCTRL_FJOIN_TX_BITS) | (join == PIO_FIFO_JOIN_TX ? PIO_SM_SHIFTCTRL_FJOIN_TX_BITS : 0);
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div)
+{
+    c->clkdiv = (uint32_t)(div * 256.0f) << (PIO_SM_CLKDIV_INT_LSB - 8);
+}
+
+static inline pio_sm_config pio_get_default_sm_config(void)
+{
+    pio_sm_config c = {1u << PIO_SM_CLKDIV_INT_LSB, 0, 0, 0};
+    sm_config_set_out_shift(&c, true, false, 32);
+    return c;
+}
+
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    // DREQ_PIO0_TX0 is 0, DREQ_PIO1_TX0 is 8
+    return sm + (is_tx ? 0 : NUM_PIO_STATE_MACHINES) + pio->index * 8;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+
+#endif
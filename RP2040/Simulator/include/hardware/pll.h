@@ -0,0 +1,22 @@
+#ifndef _HARDWARE_PLL_H
+#define _HARDWARE_PLL_H
+
+#include "pico.h"
+
+typedef struct
+{
+    bool running;
+    uint32_t outputHz;
+} pll_hw_t;
+
+typedef pll_hw_t *PLL;
+
+extern pll_hw_t simPllSys;
+extern pll_hw_t simPllUsb;
+#define pll_sys (&simPllSys)
+#define pll_usb (&simPllUsb)
+
+void pll_init(PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2);
+void pll_deinit(PLL pll);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _HARDWARE_REGS_ADDRESSMAP_H
+#define _HARDWARE_REGS_ADDRESSMAP_H
+
+#include <stdint.h>
+
+/// @brief The flash is a host array, reads through XIP are plain reads from it.
+extern uint8_t simFlash[];
+#define XIP_BASE ((uintptr_t)simFlash)
+
+#endif
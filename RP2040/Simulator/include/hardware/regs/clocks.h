@@ -0,0 +1,31 @@
+#ifndef _HARDWARE_REGS_CLOCKS_H
+#define _HARDWARE_REGS_CLOCKS_H
+
+// Host stand-in for the clock control register bits the firmware uses.
+
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF 0x0
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX 0x1
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS 0x0
+
+#define CLOCKS_SLEEP_EN0_CLK_SYS_SRAM3_BITS 0x80000000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_SRAM2_BITS 0x40000000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_SRAM1_BITS 0x20000000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_SRAM0_BITS 0x10000000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_SIO_BITS 0x00800000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS 0x00400000
+#define CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS 0x00200000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS 0x00020000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PIO1_BITS 0x00002000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PIO0_BITS 0x00001000
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS 0x00000800
+#define CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS 0x00000100
+#define CLOCKS_SLEEP_EN0_CLK_SYS_DMA_BITS 0x00000020
+#define CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS 0x00000010
+
+#define CLOCKS_SLEEP_EN1_CLK_SYS_XIP_BITS 0x00002000
+#define CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS 0x00001000
+#define CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS 0x00000020
+#define CLOCKS_SLEEP_EN1_CLK_SYS_SRAM5_BITS 0x00000002
+#define CLOCKS_SLEEP_EN1_CLK_SYS_SRAM4_BITS 0x00000001
+
+#endif
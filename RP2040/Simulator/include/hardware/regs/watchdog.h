@@ -0,0 +1,12 @@
+#ifndef _HARDWARE_REGS_WATCHDOG_H
+#define _HARDWARE_REGS_WATCHDOG_H
+
+#define WATCHDOG_CTRL_ENABLE_BITS 0x40000000
+#define WATCHDOG_CTRL_PAUSE_DBG0_BITS 0x02000000
+#define WATCHDOG_CTRL_PAUSE_DBG1_BITS 0x04000000
+#define WATCHDOG_CTRL_PAUSE_JTAG_BITS 0x01000000
+
+#define WATCHDOG_REASON_FORCE_BITS 0x00000002
+#define WATCHDOG_REASON_TIMER_BITS 0x00000001
+
+#endif
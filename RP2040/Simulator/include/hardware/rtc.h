@@ -0,0 +1,16 @@
+#ifndef _HARDWARE_RTC_H
+#define _HARDWARE_RTC_H
+
+#include "pico.h"
+
+typedef void (*rtc_callback_t)(void);
+
+void rtc_init(void);
+bool rtc_set_datetime(datetime_t *t);
+bool rtc_get_datetime(datetime_t *t);
+bool rtc_running(void);
+void rtc_set_alarm(datetime_t *t, rtc_callback_t user_callback);
+void rtc_enable_alarm(void);
+void rtc_disable_alarm(void);
+
+#endif
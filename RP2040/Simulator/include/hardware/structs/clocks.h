@@ -0,0 +1,19 @@
+#ifndef _HARDWARE_STRUCTS_CLOCKS_H
+#define _HARDWARE_STRUCTS_CLOCKS_H
+
+#include "pico.h"
+#include "hardware/regs/clocks.h"
+
+/// @brief Only the clock gating registers, the clock generators are set up through clock_configure.
+typedef struct
+{
+    uint32_t wake_en0;
+    uint32_t wake_en1;
+    uint32_t sleep_en0;
+    uint32_t sleep_en1;
+} clocks_hw_t;
+
+extern clocks_hw_t simClocks;
+#define clocks_hw (&simClocks)
+
+#endif
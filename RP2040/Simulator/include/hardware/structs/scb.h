@@ -0,0 +1,23 @@
+#ifndef _HARDWARE_STRUCTS_SCB_H
+#define _HARDWARE_STRUCTS_SCB_H
+
+#include "pico.h"
+
+#define M0PLUS_SCR_SEVONPEND_BITS 0x00000010
+#define M0PLUS_SCR_SLEEPDEEP_BITS 0x00000004
+#define M0PLUS_SCR_SLEEPONEXIT_BITS 0x00000002
+
+typedef struct
+{
+    uint32_t cpuid;
+    uint32_t icsr;
+    uint32_t vtor;
+    uint32_t aircr;
+    uint32_t scr;
+} armv6m_scb_t;
+
+/// @brief The scb is private to each core, scb_hw is the one of the core that accesses it.
+extern armv6m_scb_t simScb[2];
+#define scb_hw (&simScb[get_core_num()])
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _HARDWARE_STRUCTS_WATCHDOG_H
+#define _HARDWARE_STRUCTS_WATCHDOG_H
+
+#include "pico.h"
+#include "hardware/regs/watchdog.h"
+
+typedef struct
+{
+    uint32_t ctrl;
+    uint32_t load;
+    uint32_t reason;
+    uint32_t scratch[8];
+    uint32_t tick;
+} watchdog_hw_t;
+
+extern watchdog_hw_t simWatchdog;
+#define watchdog_hw (&simWatchdog)
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _PICO_H
+#define _PICO_H
+
+// Host stand-in for the parts of the Pico SDK base header the firmware uses.
+
+#include "pico/types.h"
+
+#ifndef count_of
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((b) > (a) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __uninitialized_ram(group) group
+
+/// @brief Flash of the Pico board.
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+enum pico_error_codes
+{
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3,
+};
+
+static inline void hw_set_bits(volatile uint32_t *addr, uint32_t mask)
+{
+    *addr |= mask;
+}
+
+static inline void hw_clear_bits(volatile uint32_t *addr, uint32_t mask)
+{
+    *addr &= ~mask;
+}
+
+void panic(const char *fmt, ...);
+uint get_core_num(void);
+
+/// @brief 0 in thread mode, otherwise the exception number of the running handler (16 plus the irq).
+uint __get_current_exception(void);
+
+static inline void tight_loop_contents(void)
+{
+    void simSpin(void);
+    simSpin();
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+#include <stdio.h>
+
+#include "pico.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+bool stdio_usb_init(void);
+bool stdio_usb_connected(void);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+#endif
@@ -0,0 +1,171 @@
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "StepGenerator.pio.h"
+#include "Power.h"
+#include "StepGenerator.h"
+#include "Stepper.h"
+#include "Trace.h"
+#include "WarmStart.h"
+#include "WorkQueue.h"
+
+// Plays back a planned seek on the coils with a PIO state machine. The whole seek is worked out up front,
+// a DMA channel feeds it into the TX FIFO and the state machine times the steps on its own, so the cpu
+// gets one interrupt at the end of the seek instead of one per step.
+
+/// @brief The coils of both stepper motors are on gpio 0 to 7.
+#define STEP_GENERATOR_PIN_BASE 0
+#define STEP_GENERATOR_PIN_COUNT 8
+#define STEP_GENERATOR_PIN_MASK (((1u << STEP_GENERATOR_PIN_COUNT) - 1) << STEP_GENERATOR_PIN_BASE)
+
+/// @brief The state machine counts the delay between two steps in us.
+#define STEP_GENERATOR_FREQUENCY 1000000
+
+/// @brief Largest delay that fits into a word of the program.
+#define STEP_GENERATOR_MAX_DELAY ((1u << 23) - 1)
+
+/// @brief Number of entries of the plan, every entry holds at least one step. This only fits because no group moves
+/// a hand more than half a revolution: seekClockHands takes the shorter way round and seekMoveHand splits longer
+/// moves. A plan that doesn't fit panics.
+#define STEP_GENERATOR_CAPACITY STEPS_PER_REVOLUTION
+
+static const PIO stepGeneratorPio = pio1;
+static const uint stepGeneratorSm = 0;
+
+static int dmaChannel;
+
+static struct motionPlanStep plan[STEP_GENERATOR_CAPACITY];
+
+/// @brief The plan in the format expected by the PIO program, one word per entry.
+static uint32_t words[STEP_GENERATOR_CAPACITY];
+
+/// @brief Coils of all motors after the last step, handed back to SIO once the seek is done.
+static struct stepperGroup finalCoils = STEPPER_GROUP_INIT;
+
+/// @brief Set while the state machine owns the coil pins.
+static volatile bool active = false;
+
+/// @brief Keeps the state machine counting in us when clk_sys changes.
+static void stepGeneratorClockChanged(struct powerClockListener *listener, uint32_t sysHz)
+{
+    pio_sm_set_clkdiv(stepGeneratorPio, stepGeneratorSm, (float)sysHz / STEP_GENERATOR_FREQUENCY);
+}
+
+static struct powerClockListener clockListener = POWER_CLOCK_LISTENER_INIT(stepGeneratorClockChanged);
+
+/// @brief Handles the state machine having written the last step of the seek and gives the pins back to SIO.
+static void stepGeneratorIrqHandler()
+{
+    TRACE_ENTER(TRACE_UNKNOWN_TIME);
+
+    pio_interrupt_clear(stepGeneratorPio, 0);
+
+    // Set the SIO levels before the pins switch over so they don't glitch. Also starts the hold timers of the motors
+    stepperGroupCommit(&finalCoils);
+
+    for (uint pin = STEP_GENERATOR_PIN_BASE; pin < STEP_GENERATOR_PIN_BASE + STEP_GENERATOR_PIN_COUNT; pin++)
+        gpio_set_function(pin, GPIO_FUNC_SIO);
+
+    active = false;
+    powerRelease(POWER_STATE_STEPPING);
+
+    TRACE_EXIT(TRACE_STEP_GENERATOR);
+}
+
+/// @brief Loads the step generator program and sets up the DMA channel that feeds it.
+void stepGeneratorInit()
+{
+    uint offset = pio_add_program(stepGeneratorPio, &step_generator_program);
+    step_generator_program_init(stepGeneratorPio, stepGeneratorSm, offset, STEP_GENERATOR_PIN_BASE, STEP_GENERATOR_PIN_COUNT, STEP_GENERATOR_FREQUENCY);
+    powerAddClockListener(&clockListener);
+
+    dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config dmaConfig = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&dmaConfig, DMA_SIZE_32);
+    channel_config_set_read_increment(&dmaConfig, true);
+    channel_config_set_write_increment(&dmaConfig, false);
+    channel_config_set_dreq(&dmaConfig, pio_get_dreq(stepGeneratorPio, stepGeneratorSm, true));
+    dma_channel_configure(dmaChannel, &dmaConfig, &stepGeneratorPio->txf[stepGeneratorSm], words, 0, false);
+
+    pio_set_irq0_source_enabled(stepGeneratorPio, pis_interrupt0, true);
+    irq_set_exclusive_handler(PIO1_IRQ_0, stepGeneratorIrqHandler);
+    irq_set_enabled(PIO1_IRQ_0, true);
+}
+
+/// @brief Plans the prepared moves of the group and starts playing them back. Returns immediately.
+/// The steppers already point to the end of the moves, stepGeneratorIsActive tells when the motors got there.
+/// @param group The motors to move.
+void stepGeneratorStart(struct motionGroup *group)
+{
+    if (active)
+        panic("Step generator is still running");
+
+    // The state machine writes all coil pins, so all motors on them need to be part of the group
+    uint32_t coils = 0;
+    for (uint32_t i = 0; i < group->motionCount; i++)
+        coils |= stepperGetOutput(group->motions[i]->stepper);
+
+    uint32_t startCoils = coils;
+
+    uint32_t length = motionGroupPlan(group, plan, count_of(plan));
+    if (length == 0)
+        return;
+
+    // The coils stay fully on until the seek is done
+    for (uint32_t i = 0; i < group->motionCount; i++)
+        stepperKeepEnergized(group->motions[i]->stepper);
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        uint32_t delay = plan[i].interval > step_generator_overhead_cycles ? plan[i].interval - step_generator_overhead_cycles : 0;
+        if (delay > STEP_GENERATOR_MAX_DELAY)
+            delay = STEP_GENERATOR_MAX_DELAY;
+
+        coils = (coils & ~plan[i].steps.mask) | plan[i].steps.value;
+
+        words[i] = delay | (((coils & STEP_GENERATOR_PIN_MASK) >> STEP_GENERATOR_PIN_BASE) << 23);
+    }
+    words[length - 1] |= 1u << 31;
+    finalCoils.mask = STEP_GENERATOR_PIN_MASK;
+    finalCoils.value = coils;
+
+    // Hand the pins over to the state machine without changing their level
+    active = true;
+    powerRequest(POWER_STATE_STEPPING);
+    pio_sm_set_pins_with_mask(stepGeneratorPio, stepGeneratorSm, startCoils, STEP_GENERATOR_PIN_MASK);
+    for (uint pin = STEP_GENERATOR_PIN_BASE; pin < STEP_GENERATOR_PIN_BASE + STEP_GENERATOR_PIN_COUNT; pin++)
+        pio_gpio_init(stepGeneratorPio, pin);
+
+    dma_channel_transfer_from_buffer_now(dmaChannel, words, length);
+}
+
+/// @brief Indicates whether the state machine still has steps to output.
+bool stepGeneratorIsActive()
+{
+    return active;
+}
+
+/// @brief Plays back the prepared moves of the group and sleeps until the last step has been taken.
+/// @param group The motors to move.
+void stepGeneratorRun(struct motionGroup *group)
+{
+    stepGeneratorStart(group);
+
+    // With interrupts disabled the irq at the end of the seek still wakes the core if it happens before the wfi
+    while (true)
+    {
+        workQueueRun();
+
+        uint32_t status = save_and_disable_interrupts();
+        bool done = !active;
+        if (!done && workQueueIsEmpty())
+            warmStartWaitForInterrupt();
+        restore_interrupts(status);
+
+        if (done)
+            break;
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef STEP_GENERATOR_H
+#define STEP_GENERATOR_H
+
+#include "pico/types.h"
+
+#include "Motion.h"
+
+void stepGeneratorInit();
+void stepGeneratorStart(struct motionGroup *group);
+bool stepGeneratorIsActive();
+void stepGeneratorRun(struct motionGroup *group);
+
+#endif
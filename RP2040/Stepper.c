@@ -1,5 +1,12 @@
+#include "hardware/clocks.h"
 #include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
 
+#include "EventLog.h"
+#include "Power.h"
+#include "Scheduler.h"
 #include "Stepper.h"
 
 /*
@@ -16,6 +23,24 @@
 const uint32_t stepSequence[] = {0b1000, 0b0010, 0b0100, 0b0001};
 const uint32_t stepSequenceLength = count_of(stepSequence);
 
+/// @brief Quarter of a sine wave over one full step in Q12 (4096 = 1.0), one entry per microstep and the end point.
+/// Generated with round(sin(i * 90 / STEPPER_MICROSTEPS degrees) * 4096).
+static const uint16_t microstepSine[STEPPER_MICROSTEPS + 1] = {0, 799, 1567, 2276, 2896, 3406, 3784, 4017, 4096};
+
+/// @brief Frequency of the pwm driving the coils, above what can be heard.
+#define STEPPER_PWM_FREQUENCY 25000
+
+/// @brief Wrap of the pwm slices driving the coils for the current system clock (4999 at 125MHz).
+static uint32_t pwmTop;
+
+/// @brief Duty of the coils in percent while the motor is moving.
+/// Wave drive switches the coil fully on, microstepping uses STEPPER_MICROSTEP_DUTY.
+#define STEPPER_RUN_DUTY 100
+
+/// @brief Peak duty of each coil in percent when microstepping.
+/// Between two full steps both coils are on at 71% of the peak, so both together never draw more than one coil at full duty.
+#define STEPPER_MICROSTEP_DUTY 70
+
 /// @brief Configuration for a stepper motor
 struct stepper
 {
@@ -28,13 +53,63 @@ struct stepper
 
     /// @brief Initial index of the step sequnce array. Leave at zero.
     uint32_t step_index;
+
+    /// @brief Microsteps taken from the full step at step_index towards the next one (0 to STEPPER_MICROSTEPS - 1).
+    /// Always zero with wave drive. Leave at zero.
+    uint32_t microstep;
+
+    /// @brief Drive the coils with sine and cosine shaped pwm duty instead of switching one coil fully on.
+    bool microstepping;
+
+    /// @brief Position of the clock hand in steps clockwise from the 12 o'clock position.
+    /// Only valid after the hand has been homed.
+    uint32_t position;
+
+    /// @brief What happens to the coils once the motor has settled after a step (enum stepperHoldMode).
+    uint8_t holdMode;
+
+    /// @brief Duty of the coils in percent of the running duty while holding with STEPPER_HOLD_REDUCED.
+    uint8_t holdDuty;
+
+    /// @brief Time from the last step until the hold mode takes over in us.
+    uint32_t settleTime;
+
+    /// @brief Set while the coils are driven with the running duty. Leave at false.
+    bool energized;
+
+    /// @brief Timer event that switches the coils to the hold mode once the motor has settled.
+    struct schedulerEvent holdEvent;
+
+    /// @brief Runs the step sequence the other way round for a motor that is wired the other way round.
+    /// Set by stepperSetInverted.
+    bool inverted;
 };
 
+static void stepperHoldHandler(struct schedulerEvent *event);
+static void stepperClockChanged(struct powerClockListener *listener, uint32_t sysHz);
+
+/// @brief Sets the wrap of the pwm slices again when clk_sys changes.
+static struct powerClockListener clockListener = POWER_CLOCK_LISTENER_INIT(stepperClockChanged);
+
+/// @brief Steppers that have been initialized, their hold timers get restarted when a group containing them is committed.
+#define STEPPER_MAX_COUNT 4
+static struct stepper *steppers[STEPPER_MAX_COUNT];
+static uint32_t stepperCount = 0;
+
 /// @brief Configuration for the hour stepper motor.
 struct stepper hourStepper = {
     0b00001111,
     0,
     0,
+    0,
+    STEPPER_MICROSTEPPING,
+    0,
+    STEPPER_HOLD_MODE,
+    STEPPER_HOLD_DUTY,
+    STEPPER_SETTLE_TIME,
+    false,
+    SCHEDULER_EVENT_INIT(stepperHoldHandler),
+    false,
 };
 
 /// @brief Configuration for the minute stepper motor.
@@ -42,21 +117,187 @@ struct stepper minuteStepper = {
     0b11110000,
     4,
     0,
+    0,
+    STEPPER_MICROSTEPPING,
+    0,
+    STEPPER_HOLD_MODE,
+    STEPPER_HOLD_DUTY,
+    STEPPER_SETTLE_TIME,
+    false,
+    SCHEDULER_EVENT_INIT(stepperHoldHandler),
+    false,
 };
 
+/// @brief Sine of an electrical angle in Q12.
+/// @param angle The angle in microsteps, STEPPER_MICROSTEPS per 90 degrees.
+static int32_t microstepSin(uint32_t angle)
+{
+    uint32_t quadrant = (angle / STEPPER_MICROSTEPS) % 4;
+    uint32_t index = angle % STEPPER_MICROSTEPS;
+
+    switch (quadrant)
+    {
+    case 0:
+        return microstepSine[index];
+    case 1:
+        return microstepSine[STEPPER_MICROSTEPS - index];
+    case 2:
+        return -microstepSine[index];
+    default:
+        return -microstepSine[STEPPER_MICROSTEPS - index];
+    }
+}
+
+/// @brief Compare level of a pwm slice for the given part of the given duty.
+/// @param fraction Part of the duty in Q12.
+/// @param duty Duty in percent.
+static uint16_t pwmLevel(uint32_t fraction, uint32_t duty)
+{
+    return (fraction * (pwmTop + 1) * duty) / (4096 * 100);
+}
+
+/// @brief Drives one coil through its two h-bridge inputs. The input of the other polarity stays low (fast decay).
+/// @param gpio The gpio of the first input of the coil, the second one is the next gpio.
+/// @param current Signed current of the coil in Q12.
+/// @param duty Peak duty of the coil in percent.
+static void driveCoil(uint gpio, int32_t current, uint32_t duty)
+{
+    uint32_t magnitude = current < 0 ? -current : current;
+    uint16_t level = pwmLevel(magnitude, duty);
+
+    pwm_set_gpio_level(gpio, current > 0 ? level : 0);
+    pwm_set_gpio_level(gpio + 1, current < 0 ? level : 0);
+}
+
+/// @brief Sets the pwm duty of both coils for the current electrical angle of a microstepping stepper motor.
+/// The compare values are double buffered by the pwm slices and take effect together at the next wrap.
+/// @param duty Duty in percent of STEPPER_MICROSTEP_DUTY, zero releases the coils.
+static void outputMicrostep(struct stepper *stepper, uint32_t duty)
+{
+    // The full steps of the step sequence are at 0, 90, 180 and 270 degrees:
+    // 0b1000 is coil B negative, 0b0010 coil A negative, 0b0100 coil B positive and 0b0001 coil A positive
+    uint32_t angle = (stepper->step_index * STEPPER_MICROSTEPS) + stepper->microstep;
+
+    duty = (duty * STEPPER_MICROSTEP_DUTY) / 100;
+    driveCoil(stepper->gpio_shift, -microstepSin(angle), duty);
+    driveCoil(stepper->gpio_shift + 2, -microstepSin(angle + STEPPER_MICROSTEPS), duty);
+}
+
+/// @brief Sets up the pwm slices of the h-bridge inputs of a stepper motor with all levels at zero.
+/// The gpio functions are left alone.
+static void initPwmSlices(struct stepper *stepper)
+{
+    // One slice drives the two inputs of each coil
+    uint32_t sliceMask = 0;
+    for (uint gpio = stepper->gpio_shift; gpio < stepper->gpio_shift + 4; gpio += 2)
+    {
+        uint slice = pwm_gpio_to_slice_num(gpio);
+        pwm_config config = pwm_get_default_config();
+        pwm_config_set_wrap(&config, pwmTop);
+        pwm_init(slice, &config, false);
+        sliceMask |= 1u << slice;
+    }
+
+    // Start the slices together so their wraps line up
+    pwm_set_mask_enabled(pwm_hw->en | sliceMask);
+}
+
+/// @brief Gives the h-bridge inputs of a stepper motor to the given peripheral.
+static void setStepperFunction(struct stepper *stepper, enum gpio_function function)
+{
+    for (uint gpio = stepper->gpio_shift; gpio < stepper->gpio_shift + 4; gpio++)
+        gpio_set_function(gpio, function);
+}
+
 /// @brief Initializes the gpio pins for a stepper motor using the given configuration.
 /// @param stepper The stepper motor to configure.
 void initStepper(struct stepper *stepper)
 {
     gpio_init_mask(stepper->gpio_mask);
     gpio_set_dir_out_masked(stepper->gpio_mask);
-    gpio_put_masked(stepper->gpio_mask, stepSequence[0] << stepper->gpio_shift);
+
+    if (stepperCount == STEPPER_MAX_COUNT)
+        panic("Too many steppers");
+    steppers[stepperCount++] = stepper;
+
+    if (stepperCount == 1)
+    {
+        pwmTop = clock_get_hz(clk_sys) / STEPPER_PWM_FREQUENCY - 1;
+        powerAddClockListener(&clockListener);
+    }
+
+    // Wave drive only needs the pwm slices to hold with reduced duty
+    if (stepper->microstepping || stepper->holdMode == STEPPER_HOLD_REDUCED)
+        initPwmSlices(stepper);
+
+    if (stepper->microstepping)
+        setStepperFunction(stepper, GPIO_FUNC_PWM);
+
+    // Energize the first step and start the hold timer
+    stepperWake(stepper);
 }
 
-/// @brief Moves the given stepper motor in the indicated direction.
-/// @param stepper The stepper motor to move.
-/// @param forward The direction to move the stepper motor.
-void stepperStep(struct stepper *stepper, bool forward)
+/// @brief Marks the current position of the clock hand as the 12 o'clock position.
+/// @param stepper The stepper motor that has been homed.
+void stepperSetHome(struct stepper *stepper)
+{
+    stepper->position = 0;
+}
+
+/// @brief Sets whether the step sequence of the given stepper motor runs the other way round.
+/// @param stepper The stepper motor to invert.
+/// @param inverted true for a motor that is wired the other way round.
+void stepperSetInverted(struct stepper *stepper, bool inverted)
+{
+    stepper->inverted = inverted;
+}
+
+/// @brief Returns the position of the clock hand driven by the given stepper motor.
+/// @param stepper The stepper motor to get the position of.
+/// @return The position in steps clockwise from the 12 o'clock position (0 to STEPS_PER_REVOLUTION - 1).
+uint32_t stepperGetPosition(struct stepper *stepper)
+{
+    return stepper->position;
+}
+
+/// @brief Returns where in the step sequence the coils of the given stepper motor are.
+/// @param stepper The stepper motor to get the phase of.
+/// @return The full step times STEPPER_MICROSTEPS plus the microstep (0 to 4 * STEPPER_MICROSTEPS - 1).
+uint32_t stepperGetPhase(struct stepper *stepper)
+{
+    return stepper->step_index * STEPPER_MICROSTEPS + stepper->microstep;
+}
+
+/// @brief Sets the position of the clock hand and the phase of the coils the motor was left at before a reset,
+/// so the coils get energized where the rotor is and the hand doesn't need to be homed again.
+/// Needs to be called before initStepper.
+/// @param stepper The stepper motor to restore.
+/// @param position The position of the clock hand (see stepperGetPosition).
+/// @param phase The phase of the coils (see stepperGetPhase).
+void stepperRestore(struct stepper *stepper, uint32_t position, uint32_t phase)
+{
+    stepper->position = position % STEPS_PER_REVOLUTION;
+    stepper->step_index = (phase / STEPPER_MICROSTEPS) % stepSequenceLength;
+    stepper->microstep = stepper->microstepping ? phase % STEPPER_MICROSTEPS : 0;
+}
+
+/// @brief Returns the number of steps a stepper motor takes per full step.
+/// @return STEPPER_MICROSTEPS when microstepping, otherwise 1.
+uint32_t stepperGetMicrosteps(struct stepper *stepper)
+{
+    return stepper->microstepping ? STEPPER_MICROSTEPS : 1;
+}
+
+/// @brief Returns the output bits the h-bridge of the given stepper motor is currently driven with.
+/// @param stepper The stepper motor to get the output of.
+/// @return The output bits already shifted to the gpio mask of the stepper.
+uint32_t stepperGetOutput(struct stepper *stepper)
+{
+    return stepSequence[stepper->step_index] << stepper->gpio_shift;
+}
+
+/// @brief Moves the step sequence a full step in the given direction.
+static void advanceSequence(struct stepper *stepper, bool forward)
 {
     if (forward)
     {
@@ -72,9 +313,243 @@ void stepperStep(struct stepper *stepper, bool forward)
         else
             stepper->step_index = stepSequenceLength - 1;
     }
+}
 
-    uint32_t value = stepSequence[stepper->step_index];
-    uint32_t shiftedValue = value << stepper->gpio_shift;
+/// @brief Moves the step sequence and the position of the given stepper motor a full step in the indicated direction.
+static void advanceFullStep(struct stepper *stepper, bool forward)
+{
+    // An inverted motor turns the other way with the same sequence, the hand still goes where it was asked to
+    advanceSequence(stepper, forward != stepper->inverted);
 
-    gpio_put_masked(stepper->gpio_mask, shiftedValue);
+    if (forward)
+    {
+        if (stepper->position > 0)
+            stepper->position--;
+        else
+            stepper->position = STEPS_PER_REVOLUTION - 1;
+    }
+    else
+    {
+        if (stepper->position < STEPS_PER_REVOLUTION - 1)
+            stepper->position++;
+        else
+            stepper->position = 0;
+    }
+}
+
+/// @brief Moves a microstepping stepper motor one microstep in the indicated direction.
+/// The full step and the position change once the motor gets to the next full step.
+static void advanceMicrostep(struct stepper *stepper, bool forward)
+{
+    if (forward != stepper->inverted)
+    {
+        if (++stepper->microstep == STEPPER_MICROSTEPS)
+        {
+            stepper->microstep = 0;
+            advanceFullStep(stepper, forward);
+        }
+    }
+    else
+    {
+        if (stepper->microstep == 0)
+        {
+            stepper->microstep = STEPPER_MICROSTEPS;
+            advanceFullStep(stepper, forward);
+        }
+        stepper->microstep--;
+    }
+}
+
+/// @brief Stages the current output of a stepper motor in the group.
+/// Wave drive gets written by the commit, the pwm duty of a microstepping motor gets set right away.
+static void stageOutput(struct stepperGroup *group, struct stepper *stepper)
+{
+    group->mask |= stepper->gpio_mask;
+
+    if (stepper->microstepping)
+        outputMicrostep(stepper, STEPPER_RUN_DUTY);
+    else
+        group->value |= stepperGetOutput(stepper);
+}
+
+/// @brief Duty of the coils in percent of the running duty while the stepper motor holds.
+static uint32_t holdDuty(struct stepper *stepper)
+{
+    return stepper->holdMode == STEPPER_HOLD_REDUCED ? stepper->holdDuty : 0;
+}
+
+/// @brief The h-bridge input that is high in the current full step of a wave driven stepper motor.
+static uint activeGpio(struct stepper *stepper)
+{
+    return stepper->gpio_shift + __builtin_ctz(stepSequence[stepper->step_index]);
+}
+
+/// @brief Switches the coils of a stepper motor that has settled to its hold mode.
+static void stepperHoldHandler(struct schedulerEvent *event)
+{
+    struct stepper *stepper = (struct stepper *)((uint8_t *)event - offsetof(struct stepper, holdEvent));
+    uint32_t duty = holdDuty(stepper);
+
+    stepper->energized = false;
+
+    if (stepper->microstepping)
+    {
+        outputMicrostep(stepper, duty);
+        return;
+    }
+
+    if (duty == 0)
+    {
+        gpio_put_masked(stepper->gpio_mask, 0);
+        return;
+    }
+
+    // Only the input of the energized coil gets pwm, the others stay low
+    uint gpio = activeGpio(stepper);
+    pwm_set_gpio_level(gpio, pwmLevel(4096, duty));
+    gpio_set_function(gpio, GPIO_FUNC_PWM);
+}
+
+/// @brief Sets the wrap of the pwm slices for the new system clock so they stay at STEPPER_PWM_FREQUENCY,
+/// and the compare levels again so the coils keep their duty.
+static void stepperClockChanged(struct powerClockListener *listener, uint32_t sysHz)
+{
+    pwmTop = sysHz / STEPPER_PWM_FREQUENCY - 1;
+
+    for (uint32_t i = 0; i < stepperCount; i++)
+    {
+        struct stepper *stepper = steppers[i];
+
+        for (uint gpio = stepper->gpio_shift; gpio < stepper->gpio_shift + 4; gpio += 2)
+            pwm_set_wrap(pwm_gpio_to_slice_num(gpio), pwmTop);
+
+        if (stepper->microstepping)
+            outputMicrostep(stepper, stepper->energized ? STEPPER_RUN_DUTY : holdDuty(stepper));
+        else if (!stepper->energized && stepper->holdMode == STEPPER_HOLD_REDUCED)
+            pwm_set_gpio_level(activeGpio(stepper), pwmLevel(4096, stepper->holdDuty));
+    }
+}
+
+/// @brief Drives the coils of a stepper motor whose output has just been written with the running duty again
+/// and restarts its hold timer.
+static void stepperEnergize(struct stepper *stepper)
+{
+    if (!stepper->energized && !stepper->microstepping && stepper->holdMode == STEPPER_HOLD_REDUCED)
+        setStepperFunction(stepper, GPIO_FUNC_SIO);
+
+    stepper->energized = true;
+
+    if (stepper->holdMode != STEPPER_HOLD_FULL)
+        schedulerAdd(&stepper->holdEvent, time_us_64() + stepper->settleTime);
+}
+
+/// @brief Drives the coils of the given stepper motor with its last step at the running duty again.
+/// Called shortly before the next step so the rotor is pulled back onto its step if it moved while the coils were held.
+/// @param stepper The stepper motor to wake.
+void stepperWake(struct stepper *stepper)
+{
+    struct stepperGroup group = STEPPER_GROUP_INIT;
+    stageOutput(&group, stepper);
+    stepperGroupCommit(&group);
+}
+
+/// @brief Keeps the hold mode from taking over until the stepper is committed again.
+/// For when something other than the stepper group drives the coils (step generator).
+/// @param stepper The stepper motor that gets driven.
+void stepperKeepEnergized(struct stepper *stepper)
+{
+    schedulerRemove(&stepper->holdEvent);
+    stepper->energized = true;
+}
+
+/// @brief Indicates whether initStepper has been called for the given stepper motor.
+static bool isInitialized(struct stepper *stepper)
+{
+    for (uint32_t i = 0; i < stepperCount; i++)
+        if (steppers[i] == stepper)
+            return true;
+
+    return false;
+}
+
+/// @brief Changes what happens to the coils of the given stepper motor once it has settled after a step.
+/// Before initStepper it only sets the mode to start with. Afterwards coils that are held get driven with the
+/// running duty and settle again into the new mode, a motor that was kept fully on gets there after its next step.
+/// @param stepper The stepper motor to configure.
+/// @param mode One of enum stepperHoldMode.
+/// @param duty Duty in percent of the running duty for STEPPER_HOLD_REDUCED.
+void stepperSetHold(struct stepper *stepper, enum stepperHoldMode mode, uint8_t duty)
+{
+    uint32_t status = save_and_disable_interrupts();
+
+    if (isInitialized(stepper))
+    {
+        // Undo the hold of the old mode first, the wake restarts the hold timer
+        if (!stepper->energized)
+            stepperWake(stepper);
+
+        if (mode == STEPPER_HOLD_REDUCED && !stepper->microstepping && stepper->holdMode != STEPPER_HOLD_REDUCED)
+            initPwmSlices(stepper);
+
+        if (mode == STEPPER_HOLD_FULL)
+            schedulerRemove(&stepper->holdEvent);
+    }
+
+    stepper->holdMode = mode;
+    stepper->holdDuty = duty;
+    restore_interrupts(status);
+}
+
+/// @brief Adds a full step of the given stepper motor to the group. Nothing is output until the group is committed.
+/// Any number of stepper motors can be staged as long as their gpio masks don't overlap.
+/// @param group The group to add the step to.
+/// @param stepper The stepper motor to move.
+/// @param forward The direction to move the stepper motor. false moves the clock hand clockwise.
+void stepperGroupStage(struct stepperGroup *group, struct stepper *stepper, bool forward)
+{
+    advanceFullStep(stepper, forward);
+    stageOutput(group, stepper);
+}
+
+/// @brief Adds the smallest step the given stepper motor can take to the group, a microstep when microstepping and a full step otherwise.
+/// @param group The group to add the step to.
+/// @param stepper The stepper motor to move.
+/// @param forward The direction to move the stepper motor. false moves the clock hand clockwise.
+void stepperGroupStageMicrostep(struct stepperGroup *group, struct stepper *stepper, bool forward)
+{
+    if (stepper->microstepping)
+        advanceMicrostep(stepper, forward);
+    else
+        advanceFullStep(stepper, forward);
+
+    stageOutput(group, stepper);
+}
+
+/// @brief Outputs the steps of all staged stepper motors with a single write so all coils switch at the same time.
+/// Coils that were held are driven with the running duty again and the hold timers of all staged motors restart.
+/// The group is empty afterwards and can be reused.
+/// @param group The group to output.
+void stepperGroupCommit(struct stepperGroup *group)
+{
+    if (group->mask != 0)
+        gpio_put_masked(group->mask, group->value);
+
+    eventLogWrite(EVENT_COILS, group->mask, group->value);
+
+    for (uint32_t i = 0; i < stepperCount; i++)
+        if (steppers[i]->gpio_mask & group->mask)
+            stepperEnergize(steppers[i]);
+
+    group->mask = 0;
+    group->value = 0;
+}
+
+/// @brief Moves the given stepper motor in the indicated direction.
+/// @param stepper The stepper motor to move.
+/// @param forward The direction to move the stepper motor. false moves the clock hand clockwise.
+void stepperStep(struct stepper *stepper, bool forward)
+{
+    struct stepperGroup group = STEPPER_GROUP_INIT;
+    stepperGroupStage(&group, stepper, forward);
+    stepperGroupCommit(&group);
 }
@@ -1,10 +1,76 @@
 #ifndef STEPPER_H
 #define STEPPER_H
 
+#include "pico/types.h"
+
+/// @brief Each stepper has to move 60 steps per revolution (20 full steps * 3:1 gear reduction)
+#define STEPS_PER_REVOLUTION (20 * 3)
+
+/// @brief Drive the coils with pwm microstepping instead of wave drive. Set by the build.
+#ifndef STEPPER_MICROSTEPPING
+#define STEPPER_MICROSTEPPING 0
+#endif
+
+/// @brief Microsteps per full step when microstepping.
+#define STEPPER_MICROSTEPS 8
+
+/// @brief What happens to the coils of a stepper motor once it has settled after a step.
+enum stepperHoldMode
+{
+    /// @brief Keep the coils at the running duty.
+    STEPPER_HOLD_FULL,
+
+    /// @brief Drop the coils to a pwm hold duty.
+    STEPPER_HOLD_REDUCED,
+
+    /// @brief Switch the coils off, the detent torque of the motor holds the hand.
+    STEPPER_HOLD_RELEASE,
+};
+
+/// @brief Hold mode of the clock hands between two steps until SET HOLD changes it. Set by the build.
+#ifndef STEPPER_HOLD_MODE
+#define STEPPER_HOLD_MODE STEPPER_HOLD_REDUCED
+#endif
+
+/// @brief Hold duty in percent of the running duty for STEPPER_HOLD_REDUCED.
+#define STEPPER_HOLD_DUTY 25
+
+/// @brief Time from the last step until the hold mode takes over in us.
+#define STEPPER_SETTLE_TIME 50000
+
+/// @brief How long before a step the coils get woken up from the hold mode in us.
+#define STEPPER_WAKE_LEAD 20000
+
+/// @brief Steps of several stepper motors that are output together.
+struct stepperGroup
+{
+    /// @brief Combined gpio masks of all staged stepper motors.
+    /// Microstepping motors are part of it too, so their hold timers restart on the commit.
+    uint32_t mask;
+
+    /// @brief Combined output bits of all staged stepper motors.
+    uint32_t value;
+};
+
+#define STEPPER_GROUP_INIT {0, 0}
+
 extern struct stepper hourStepper;
 extern struct stepper minuteStepper;
 
 void initStepper(struct stepper *stepper);
+void stepperSetHome(struct stepper *stepper);
+void stepperSetInverted(struct stepper *stepper, bool inverted);
+uint32_t stepperGetPosition(struct stepper *stepper);
+uint32_t stepperGetPhase(struct stepper *stepper);
+void stepperRestore(struct stepper *stepper, uint32_t position, uint32_t phase);
+uint32_t stepperGetMicrosteps(struct stepper *stepper);
+uint32_t stepperGetOutput(struct stepper *stepper);
 void stepperStep(struct stepper *stepper, bool forward);
+void stepperGroupStage(struct stepperGroup *group, struct stepper *stepper, bool forward);
+void stepperGroupStageMicrostep(struct stepperGroup *group, struct stepper *stepper, bool forward);
+void stepperGroupCommit(struct stepperGroup *group);
+void stepperWake(struct stepper *stepper);
+void stepperKeepEnergized(struct stepper *stepper);
+void stepperSetHold(struct stepper *stepper, enum stepperHoldMode mode, uint8_t duty);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+#include "RTC.h"
+#include "Scheduler.h"
+#include "Storage.h"
+#include "WarmStart.h"
+
+// Writing the flash stops XIP, so no code can run from flash meanwhile. Both helpers hold off the interrupts
+// and lock out core 1 while the flash is busy and must only be called from thread mode on core 0.
+//
+// So no step comes late, they first sleep until nothing is due for as long as the flash typically takes: no event
+// of the scheduler (steps, coil wake ups, rtc trims, led frames) and no rtc alarm. That wait can last as long as
+// an animation plays. Only the usb and gpio interrupts get held off for the whole operation, timed events only
+// when the flash takes longer than typical (up to 400ms for an erase and 3ms for a page in the datasheet).
+
+/// @brief Typical times of the W25Q16JV on the Pico plus some margin.
+#define STORAGE_SECTOR_ERASE_US 50000
+#define STORAGE_PAGE_PROGRAM_US 1000
+
+/// @brief Sleeps until nothing is due for the given time, then returns with interrupts disabled.
+/// @param duration How long the flash will be busy in us.
+/// @return The interrupt state to restore once the flash is done.
+static uint32_t waitForQuiet(uint64_t duration)
+{
+    while (true)
+    {
+        uint32_t status = save_and_disable_interrupts();
+        uint64_t quietUntil = time_us_64() + duration;
+        if (schedulerGetNextTime() > quietUntil && rtcGetNextAlarmAt() > quietUntil)
+            return status;
+
+        // The event or alarm that is due wakes the core again
+        warmStartWaitForInterrupt();
+        restore_interrupts(status);
+    }
+}
+
+/// @brief Erases whole sectors.
+/// @param offset Offset of the first sector from the start of the flash.
+/// @param length Number of bytes to erase, a multiple of FLASH_SECTOR_SIZE.
+void storageErase(uint32_t offset, uint32_t length)
+{
+    uint32_t status = waitForQuiet(length / FLASH_SECTOR_SIZE * STORAGE_SECTOR_ERASE_US);
+    multicore_lockout_start_blocking();
+
+    flash_range_erase(offset, length);
+
+    multicore_lockout_end_blocking();
+    restore_interrupts(status);
+}
+
+/// @brief Programs data at any offset. Programming can only clear bits, the bytes need to have been erased before.
+/// The rest of the pages the data touches is programmed with 0xff, which leaves it as it is.
+/// @param offset Offset from the start of the flash.
+/// @param data The data to write.
+/// @param length Number of bytes to write.
+void storageProgram(uint32_t offset, const void *data, uint32_t length)
+{
+    static uint8_t page[FLASH_PAGE_SIZE];
+    const uint8_t *bytes = data;
+
+    while (length > 0)
+    {
+        uint32_t pageOffset = offset % FLASH_PAGE_SIZE;
+        uint32_t count = FLASH_PAGE_SIZE - pageOffset < length ? FLASH_PAGE_SIZE - pageOffset : length;
+
+        memset(page, 0xff, sizeof(page));
+        memcpy(&page[pageOffset], bytes, count);
+
+        uint32_t status = waitForQuiet(STORAGE_PAGE_PROGRAM_US);
+        multicore_lockout_start_blocking();
+
+        flash_range_program(offset - pageOffset, page, FLASH_PAGE_SIZE);
+
+        multicore_lockout_end_blocking();
+        restore_interrupts(status);
+
+        offset += count;
+        bytes += count;
+        length -= count;
+    }
+}
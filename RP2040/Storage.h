@@ -0,0 +1,27 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "pico/types.h"
+
+// Flash at the end of the chip that is kept for data, the program never gets that big.
+// From the top: the hand journal, then the two copies of the config.
+
+/// @brief Sectors of the hand journal. Each holds 512 records, a record gets written every minute.
+#define STORAGE_JOURNAL_SECTORS 4
+#define STORAGE_JOURNAL_OFFSET (PICO_FLASH_SIZE_BYTES - STORAGE_JOURNAL_SECTORS * FLASH_SECTOR_SIZE)
+
+/// @brief One sector for each of the two copies of the config.
+#define STORAGE_CONFIG_OFFSET (STORAGE_JOURNAL_OFFSET - 2 * FLASH_SECTOR_SIZE)
+
+/// @brief Returns a pointer to the given offset in the flash, it gets read through XIP like the program.
+static inline const void *storageRead(uint32_t offset)
+{
+    return (const void *)(XIP_BASE + offset);
+}
+
+void storageErase(uint32_t offset, uint32_t length);
+void storageProgram(uint32_t offset, const void *data, uint32_t length);
+
+#endif
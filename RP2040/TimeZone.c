@@ -0,0 +1,85 @@
+#include "pico/stdlib.h"
+
+#include "Config.h"
+#include "DateTimeParser.h"
+#include "TimeZone.h"
+
+// The rtc runs in UTC, the hands show the local time of the zone in config.timeZone. The offset at a given time
+// only takes the year and the quarter hour of the year: the table of the zone holds the two quarter hours at which
+// the offset changes in that year, generated on the host from its tz database (see Host/MakeTimeZones.c).
+
+/// @brief The configured zone, UTC when the settings hold a zone this firmware doesn't know.
+static const struct timeZone *currentZone()
+{
+    return &timeZones[config.timeZone < timeZoneCount ? config.timeZone : 0];
+}
+
+static char upperCase(char c)
+{
+    return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+}
+
+/// @brief Looks up a zone by its name, the case doesn't matter.
+/// @return The index of the zone, -1 when there is none by that name.
+int32_t timeZoneFind(const char *name)
+{
+    for (uint32_t i = 0; i < timeZoneCount; i++)
+    {
+        const char *a = timeZones[i].name;
+        const char *b = name;
+
+        while (*a != '\0' && upperCase(*a) == upperCase(*b))
+        {
+            a++;
+            b++;
+        }
+
+        if (*a == '\0' && *b == '\0')
+            return i;
+    }
+
+    return -1;
+}
+
+/// @brief Returns the name of the configured zone.
+const char *timeZoneGetName()
+{
+    return currentZone()->name;
+}
+
+/// @brief Returns the offset of the configured zone from UTC in minutes at the given time.
+int32_t timeZoneGetOffset(const datetime_t *utc)
+{
+    const struct timeZone *zone = currentZone();
+    if (zone->transitions == NULL)
+        return zone->offsets[0];
+
+    int32_t year = utc->year - TIME_ZONE_FIRST_YEAR;
+    if (year < 0 || year >= TIME_ZONE_YEARS)
+        return MIN(zone->offsets[0], zone->offsets[1]);
+
+    datetime_t yearStart = {utc->year, 1, 1, 0, 0, 0, 0};
+    uint32_t quarterHour = (dateTimeToSeconds(utc) - dateTimeToSeconds(&yearStart)) / TIME_ZONE_QUARTER_HOUR;
+    const uint16_t *transitions = zone->transitions[year];
+
+    return zone->offsets[quarterHour >= transitions[0] && quarterHour < transitions[1]];
+}
+
+/// @brief Converts a time of the rtc to the local time of the configured zone.
+void timeZoneToLocal(const datetime_t *utc, datetime_t *local)
+{
+    dateTimeFromSeconds(dateTimeToSeconds(utc) + timeZoneGetOffset(utc) * 60, local);
+}
+
+/// @brief Converts a local time of the configured zone to UTC for the rtc. A local time that happens twice when the
+/// clocks go back is taken as the first one, one that gets skipped when they go forward as if the clocks hadn't yet.
+void timeZoneToUtc(const datetime_t *local, datetime_t *utc)
+{
+    const struct timeZone *zone = currentZone();
+    int64_t seconds = dateTimeToSeconds(local);
+    int32_t ahead = MAX(zone->offsets[0], zone->offsets[1]);
+
+    dateTimeFromSeconds(seconds - ahead * 60, utc);
+    if (timeZoneGetOffset(utc) != ahead)
+        dateTimeFromSeconds(seconds - MIN(zone->offsets[0], zone->offsets[1]) * 60, utc);
+}
@@ -0,0 +1,37 @@
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+#include "pico/types.h"
+
+/// @brief Years the transition tables cover. Before and after them a zone stays on its standard time (the smaller offset).
+#define TIME_ZONE_FIRST_YEAR 2020
+#define TIME_ZONE_YEARS 80
+
+/// @brief The transitions are counted in quarter hours of UTC since the start of the year.
+#define TIME_ZONE_QUARTER_HOUR 900
+
+/// @brief A time zone that changes between two offsets twice a year (daylight saving time) or never.
+struct timeZone
+{
+    /// @brief Name in the tz database, what SET ZONE takes.
+    const char *name;
+
+    /// @brief Offset from UTC in minutes from the start of the year and from the first transition of the year on,
+    /// the first one again from the second transition on. Both the same for zones without transitions.
+    int16_t offsets[2];
+
+    /// @brief The two transitions of each year from TIME_ZONE_FIRST_YEAR on, NULL for zones without transitions.
+    const uint16_t (*transitions)[2];
+};
+
+/// @brief The zones the clock knows, generated by Host/MakeTimeZones.c into TimeZones.c. UTC comes first.
+extern const struct timeZone timeZones[];
+extern const uint32_t timeZoneCount;
+
+int32_t timeZoneFind(const char *name);
+const char *timeZoneGetName();
+int32_t timeZoneGetOffset(const datetime_t *utc);
+void timeZoneToLocal(const datetime_t *utc, datetime_t *local);
+void timeZoneToUtc(const datetime_t *local, datetime_t *utc);
+
+#endif
@@ -0,0 +1,309 @@
+#include "pico.h"
+
+#include "TimeZone.h"
+
+// Generated by Host/MakeTimeZones.c from the tz database 2025b, don't edit.
+// Transitions in quarter hours of UTC since the start of the years 2020 to 2099.
+
+#if TIME_ZONE_FIRST_YEAR != 2020 || TIME_ZONE_YEARS != 80 || TIME_ZONE_QUARTER_HOUR != 900
+#error The tables need to be generated again for the range of TimeZone.h
+#endif
+
+static const uint16_t europeLondon[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeDublin[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeLisbon[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeParis[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeBerlin[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeZurich[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeVienna[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t europeHelsinki[TIME_ZONE_YEARS][2] = {
+    {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612},
+    {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612},
+    {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516},
+    {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516},
+    {8260, 29092}, {8068, 28900}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092},
+    {8164, 28996}, {8068, 28900}, {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092},
+    {8164, 28996}, {7972, 28804}, {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996},
+    {8068, 28900}, {7972, 28804}, {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996},
+    {8068, 28900}, {8548, 28708}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8068, 28900},
+    {7972, 28804}, {8548, 28708}, {8452, 28612}, {8260, 29092}, {8164, 28996}, {8068, 28900},
+    {8644, 28804}, {8452, 28612}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {7972, 28804},
+    {8548, 28708}, {8452, 28612}, {8356, 29188}, {8164, 28996}, {8068, 28900}, {7972, 28804},
+    {8548, 28708}, {8356, 28516}, {8260, 29092}, {8164, 28996}, {8068, 28900}, {8548, 28708},
+    {8452, 28612}, {8356, 28516},
+};
+
+static const uint16_t americaNewYork[TIME_ZONE_YEARS][2] = {
+    {6460, 29304}, {6940, 29784}, {6844, 29688}, {6748, 29592}, {6652, 29496}, {6460, 29304},
+    {6364, 29208}, {6940, 29784}, {6844, 29688}, {6652, 29496}, {6556, 29400}, {6460, 29304},
+    {7036, 29880}, {6844, 29688}, {6748, 29592}, {6652, 29496}, {6556, 29400}, {6364, 29208},
+    {6940, 29784}, {6844, 29688}, {6748, 29592}, {6556, 29400}, {6460, 29304}, {6364, 29208},
+    {6940, 29784}, {6748, 29592}, {6652, 29496}, {6556, 29400}, {6460, 29304}, {6940, 29784},
+    {6844, 29688}, {6748, 29592}, {6652, 29496}, {6460, 29304}, {6364, 29208}, {6940, 29784},
+    {6844, 29688}, {6652, 29496}, {6556, 29400}, {6460, 29304}, {7036, 29880}, {6844, 29688},
+    {6748, 29592}, {6652, 29496}, {6556, 29400}, {6364, 29208}, {6940, 29784}, {6844, 29688},
+    {6748, 29592}, {6556, 29400}, {6460, 29304}, {6364, 29208}, {6940, 29784}, {6748, 29592},
+    {6652, 29496}, {6556, 29400}, {6460, 29304}, {6940, 29784}, {6844, 29688}, {6748, 29592},
+    {6652, 29496}, {6460, 29304}, {6364, 29208}, {6940, 29784}, {6844, 29688}, {6652, 29496},
+    {6556, 29400}, {6460, 29304}, {7036, 29880}, {6844, 29688}, {6748, 29592}, {6652, 29496},
+    {6556, 29400}, {6364, 29208}, {6940, 29784}, {6844, 29688}, {6748, 29592}, {6556, 29400},
+    {6460, 29304}, {6364, 29208},
+};
+
+static const uint16_t americaChicago[TIME_ZONE_YEARS][2] = {
+    {6464, 29308}, {6944, 29788}, {6848, 29692}, {6752, 29596}, {6656, 29500}, {6464, 29308},
+    {6368, 29212}, {6944, 29788}, {6848, 29692}, {6656, 29500}, {6560, 29404}, {6464, 29308},
+    {7040, 29884}, {6848, 29692}, {6752, 29596}, {6656, 29500}, {6560, 29404}, {6368, 29212},
+    {6944, 29788}, {6848, 29692}, {6752, 29596}, {6560, 29404}, {6464, 29308}, {6368, 29212},
+    {6944, 29788}, {6752, 29596}, {6656, 29500}, {6560, 29404}, {6464, 29308}, {6944, 29788},
+    {6848, 29692}, {6752, 29596}, {6656, 29500}, {6464, 29308}, {6368, 29212}, {6944, 29788},
+    {6848, 29692}, {6656, 29500}, {6560, 29404}, {6464, 29308}, {7040, 29884}, {6848, 29692},
+    {6752, 29596}, {6656, 29500}, {6560, 29404}, {6368, 29212}, {6944, 29788}, {6848, 29692},
+    {6752, 29596}, {6560, 29404}, {6464, 29308}, {6368, 29212}, {6944, 29788}, {6752, 29596},
+    {6656, 29500}, {6560, 29404}, {6464, 29308}, {6944, 29788}, {6848, 29692}, {6752, 29596},
+    {6656, 29500}, {6464, 29308}, {6368, 29212}, {6944, 29788}, {6848, 29692}, {6656, 29500},
+    {6560, 29404}, {6464, 29308}, {7040, 29884}, {6848, 29692}, {6752, 29596}, {6656, 29500},
+    {6560, 29404}, {6368, 29212}, {6944, 29788}, {6848, 29692}, {6752, 29596}, {6560, 29404},
+    {6464, 29308}, {6368, 29212},
+};
+
+static const uint16_t americaDenver[TIME_ZONE_YEARS][2] = {
+    {6468, 29312}, {6948, 29792}, {6852, 29696}, {6756, 29600}, {6660, 29504}, {6468, 29312},
+    {6372, 29216}, {6948, 29792}, {6852, 29696}, {6660, 29504}, {6564, 29408}, {6468, 29312},
+    {7044, 29888}, {6852, 29696}, {6756, 29600}, {6660, 29504}, {6564, 29408}, {6372, 29216},
+    {6948, 29792}, {6852, 29696}, {6756, 29600}, {6564, 29408}, {6468, 29312}, {6372, 29216},
+    {6948, 29792}, {6756, 29600}, {6660, 29504}, {6564, 29408}, {6468, 29312}, {6948, 29792},
+    {6852, 29696}, {6756, 29600}, {6660, 29504}, {6468, 29312}, {6372, 29216}, {6948, 29792},
+    {6852, 29696}, {6660, 29504}, {6564, 29408}, {6468, 29312}, {7044, 29888}, {6852, 29696},
+    {6756, 29600}, {6660, 29504}, {6564, 29408}, {6372, 29216}, {6948, 29792}, {6852, 29696},
+    {6756, 29600}, {6564, 29408}, {6468, 29312}, {6372, 29216}, {6948, 29792}, {6756, 29600},
+    {6660, 29504}, {6564, 29408}, {6468, 29312}, {6948, 29792}, {6852, 29696}, {6756, 29600},
+    {6660, 29504}, {6468, 29312}, {6372, 29216}, {6948, 29792}, {6852, 29696}, {6660, 29504},
+    {6564, 29408}, {6468, 29312}, {7044, 29888}, {6852, 29696}, {6756, 29600}, {6660, 29504},
+    {6564, 29408}, {6372, 29216}, {6948, 29792}, {6852, 29696}, {6756, 29600}, {6564, 29408},
+    {6468, 29312}, {6372, 29216},
+};
+
+static const uint16_t americaLosAngeles[TIME_ZONE_YEARS][2] = {
+    {6472, 29316}, {6952, 29796}, {6856, 29700}, {6760, 29604}, {6664, 29508}, {6472, 29316},
+    {6376, 29220}, {6952, 29796}, {6856, 29700}, {6664, 29508}, {6568, 29412}, {6472, 29316},
+    {7048, 29892}, {6856, 29700}, {6760, 29604}, {6664, 29508}, {6568, 29412}, {6376, 29220},
+    {6952, 29796}, {6856, 29700}, {6760, 29604}, {6568, 29412}, {6472, 29316}, {6376, 29220},
+    {6952, 29796}, {6760, 29604}, {6664, 29508}, {6568, 29412}, {6472, 29316}, {6952, 29796},
+    {6856, 29700}, {6760, 29604}, {6664, 29508}, {6472, 29316}, {6376, 29220}, {6952, 29796},
+    {6856, 29700}, {6664, 29508}, {6568, 29412}, {6472, 29316}, {7048, 29892}, {6856, 29700},
+    {6760, 29604}, {6664, 29508}, {6568, 29412}, {6376, 29220}, {6952, 29796}, {6856, 29700},
+    {6760, 29604}, {6568, 29412}, {6472, 29316}, {6376, 29220}, {6952, 29796}, {6760, 29604},
+    {6664, 29508}, {6568, 29412}, {6472, 29316}, {6952, 29796}, {6856, 29700}, {6760, 29604},
+    {6664, 29508}, {6472, 29316}, {6376, 29220}, {6952, 29796}, {6856, 29700}, {6664, 29508},
+    {6568, 29412}, {6472, 29316}, {7048, 29892}, {6856, 29700}, {6760, 29604}, {6664, 29508},
+    {6568, 29412}, {6376, 29220}, {6952, 29796}, {6856, 29700}, {6760, 29604}, {6568, 29412},
+    {6472, 29316}, {6376, 29220},
+};
+
+static const uint16_t australiaAdelaide[TIME_ZONE_YEARS][2] = {
+    {9090, 26562}, {8898, 26370}, {8802, 26274}, {8706, 26178}, {9282, 26754}, {9090, 26562},
+    {8994, 26466}, {8898, 26370}, {8802, 26274}, {8610, 26754}, {9186, 26658}, {9090, 26562},
+    {8994, 26466}, {8802, 26274}, {8706, 26178}, {8610, 26754}, {9186, 26658}, {8994, 26466},
+    {8898, 26370}, {8802, 26274}, {8706, 26850}, {9186, 26658}, {9090, 26562}, {8994, 26466},
+    {8898, 26370}, {8706, 26178}, {8610, 26754}, {9186, 26658}, {9090, 26562}, {8898, 26370},
+    {8802, 26274}, {8706, 26178}, {9282, 26754}, {9090, 26562}, {8994, 26466}, {8898, 26370},
+    {8802, 26274}, {8610, 26754}, {9186, 26658}, {9090, 26562}, {8994, 26466}, {8802, 26274},
+    {8706, 26178}, {8610, 26754}, {9186, 26658}, {8994, 26466}, {8898, 26370}, {8802, 26274},
+    {8706, 26850}, {9186, 26658}, {9090, 26562}, {8994, 26466}, {8898, 26370}, {8706, 26178},
+    {8610, 26754}, {9186, 26658}, {9090, 26562}, {8898, 26370}, {8802, 26274}, {8706, 26178},
+    {9282, 26754}, {9090, 26562}, {8994, 26466}, {8898, 26370}, {8802, 26274}, {8610, 26754},
+    {9186, 26658}, {9090, 26562}, {8994, 26466}, {8802, 26274}, {8706, 26178}, {8610, 26754},
+    {9186, 26658}, {8994, 26466}, {8898, 26370}, {8802, 26274}, {8706, 26850}, {9186, 26658},
+    {9090, 26562}, {8994, 26466},
+};
+
+static const uint16_t australiaSydney[TIME_ZONE_YEARS][2] = {
+    {9088, 26560}, {8896, 26368}, {8800, 26272}, {8704, 26176}, {9280, 26752}, {9088, 26560},
+    {8992, 26464}, {8896, 26368}, {8800, 26272}, {8608, 26752}, {9184, 26656}, {9088, 26560},
+    {8992, 26464}, {8800, 26272}, {8704, 26176}, {8608, 26752}, {9184, 26656}, {8992, 26464},
+    {8896, 26368}, {8800, 26272}, {8704, 26848}, {9184, 26656}, {9088, 26560}, {8992, 26464},
+    {8896, 26368}, {8704, 26176}, {8608, 26752}, {9184, 26656}, {9088, 26560}, {8896, 26368},
+    {8800, 26272}, {8704, 26176}, {9280, 26752}, {9088, 26560}, {8992, 26464}, {8896, 26368},
+    {8800, 26272}, {8608, 26752}, {9184, 26656}, {9088, 26560}, {8992, 26464}, {8800, 26272},
+    {8704, 26176}, {8608, 26752}, {9184, 26656}, {8992, 26464}, {8896, 26368}, {8800, 26272},
+    {8704, 26848}, {9184, 26656}, {9088, 26560}, {8992, 26464}, {8896, 26368}, {8704, 26176},
+    {8608, 26752}, {9184, 26656}, {9088, 26560}, {8896, 26368}, {8800, 26272}, {8704, 26176},
+    {9280, 26752}, {9088, 26560}, {8992, 26464}, {8896, 26368}, {8800, 26272}, {8608, 26752},
+    {9184, 26656}, {9088, 26560}, {8992, 26464}, {8800, 26272}, {8704, 26176}, {8608, 26752},
+    {9184, 26656}, {8992, 26464}, {8896, 26368}, {8800, 26272}, {8704, 26848}, {9184, 26656},
+    {9088, 26560}, {8992, 26464},
+};
+
+static const uint16_t australiaLordHowe[TIME_ZONE_YEARS][2] = {
+    {9084, 26558}, {8892, 26366}, {8796, 26270}, {8700, 26174}, {9276, 26750}, {9084, 26558},
+    {8988, 26462}, {8892, 26366}, {8796, 26270}, {8604, 26750}, {9180, 26654}, {9084, 26558},
+    {8988, 26462}, {8796, 26270}, {8700, 26174}, {8604, 26750}, {9180, 26654}, {8988, 26462},
+    {8892, 26366}, {8796, 26270}, {8700, 26846}, {9180, 26654}, {9084, 26558}, {8988, 26462},
+    {8892, 26366}, {8700, 26174}, {8604, 26750}, {9180, 26654}, {9084, 26558}, {8892, 26366},
+    {8796, 26270}, {8700, 26174}, {9276, 26750}, {9084, 26558}, {8988, 26462}, {8892, 26366},
+    {8796, 26270}, {8604, 26750}, {9180, 26654}, {9084, 26558}, {8988, 26462}, {8796, 26270},
+    {8700, 26174}, {8604, 26750}, {9180, 26654}, {8988, 26462}, {8892, 26366}, {8796, 26270},
+    {8700, 26846}, {9180, 26654}, {9084, 26558}, {8988, 26462}, {8892, 26366}, {8700, 26174},
+    {8604, 26750}, {9180, 26654}, {9084, 26558}, {8892, 26366}, {8796, 26270}, {8700, 26174},
+    {9276, 26750}, {9084, 26558}, {8988, 26462}, {8892, 26366}, {8796, 26270}, {8604, 26750},
+    {9180, 26654}, {9084, 26558}, {8988, 26462}, {8796, 26270}, {8700, 26174}, {8604, 26750},
+    {9180, 26654}, {8988, 26462}, {8892, 26366}, {8796, 26270}, {8700, 26846}, {9180, 26654},
+    {9084, 26558}, {8988, 26462},
+};
+
+static const uint16_t pacificAuckland[TIME_ZONE_YEARS][2] = {
+    {9080, 25880}, {8888, 25688}, {8792, 25592}, {8696, 25496}, {9272, 26072}, {9080, 25880},
+    {8984, 25784}, {8888, 25688}, {8792, 25592}, {8600, 26072}, {9176, 25976}, {9080, 25880},
+    {8984, 25784}, {8792, 25592}, {8696, 25496}, {8600, 26072}, {9176, 25976}, {8984, 25784},
+    {8888, 25688}, {8792, 25592}, {8696, 26168}, {9176, 25976}, {9080, 25880}, {8984, 25784},
+    {8888, 25688}, {8696, 25496}, {8600, 26072}, {9176, 25976}, {9080, 25880}, {8888, 25688},
+    {8792, 25592}, {8696, 25496}, {9272, 26072}, {9080, 25880}, {8984, 25784}, {8888, 25688},
+    {8792, 25592}, {8600, 26072}, {9176, 25976}, {9080, 25880}, {8984, 25784}, {8792, 25592},
+    {8696, 25496}, {8600, 26072}, {9176, 25976}, {8984, 25784}, {8888, 25688}, {8792, 25592},
+    {8696, 26168}, {9176, 25976}, {9080, 25880}, {8984, 25784}, {8888, 25688}, {8696, 25496},
+    {8600, 26072}, {9176, 25976}, {9080, 25880}, {8888, 25688}, {8792, 25592}, {8696, 25496},
+    {9272, 26072}, {9080, 25880}, {8984, 25784}, {8888, 25688}, {8792, 25592}, {8600, 26072},
+    {9176, 25976}, {9080, 25880}, {8984, 25784}, {8792, 25592}, {8696, 25496}, {8600, 26072},
+    {9176, 25976}, {8984, 25784}, {8888, 25688}, {8792, 25592}, {8696, 26168}, {9176, 25976},
+    {9080, 25880}, {8984, 25784},
+};
+
+const struct timeZone timeZones[] = {
+    {"UTC", {0, 0}, NULL},
+    {"Europe/London", {0, 60}, europeLondon},
+    {"Europe/Dublin", {0, 60}, europeDublin},
+    {"Europe/Lisbon", {0, 60}, europeLisbon},
+    {"Europe/Paris", {60, 120}, europeParis},
+    {"Europe/Berlin", {60, 120}, europeBerlin},
+    {"Europe/Zurich", {60, 120}, europeZurich},
+    {"Europe/Vienna", {60, 120}, europeVienna},
+    {"Europe/Helsinki", {120, 180}, europeHelsinki},
+    {"Europe/Moscow", {180, 180}, NULL},
+    {"America/New_York", {-300, -240}, americaNewYork},
+    {"America/Chicago", {-360, -300}, americaChicago},
+    {"America/Denver", {-420, -360}, americaDenver},
+    {"America/Phoenix", {-420, -420}, NULL},
+    {"America/Los_Angeles", {-480, -420}, americaLosAngeles},
+    {"America/Sao_Paulo", {-180, -180}, NULL},
+    {"Asia/Kolkata", {330, 330}, NULL},
+    {"Asia/Tokyo", {540, 540}, NULL},
+    {"Australia/Adelaide", {630, 570}, australiaAdelaide},
+    {"Australia/Sydney", {660, 600}, australiaSydney},
+    {"Australia/Lord_Howe", {660, 630}, australiaLordHowe},
+    {"Pacific/Auckland", {780, 720}, pacificAuckland},
+};
+
+const uint32_t timeZoneCount = count_of(timeZones);
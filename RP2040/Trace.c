@@ -0,0 +1,174 @@
+#include <stdio.h>
+
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "Trace.h"
+
+#if TRACE_ENABLED
+
+// Every handler run ends up in a ring buffer of the most recent runs and in statistics per source.
+// The timestamps come from the 1MHz timer, which keeps counting whatever clk_sys runs at.
+
+/// @brief Number of runs kept, needs to be a power of two.
+#define TRACE_BUFFER_LENGTH 256
+
+/// @brief Histogram buckets by powers of two: 0us, 1us, 2-3us, 4-7us, ... and everything from 256us on.
+#define TRACE_HISTOGRAM_BUCKETS 10
+
+/// @brief A single run of a handler.
+struct traceEntry
+{
+    /// @brief Low 32 bits of time_us_64 at the entry of the handler.
+    uint32_t enteredAt;
+
+    /// @brief Time from entry to exit in us, saturated.
+    uint16_t duration;
+
+    /// @brief Time from the event to the entry in us, saturated. Zero when unknown.
+    uint16_t latency;
+
+    uint8_t source;
+};
+
+struct traceStatistics
+{
+    uint32_t count;
+    uint32_t durationMin;
+    uint32_t durationMax;
+    uint64_t durationTotal;
+
+    /// @brief Only runs with a known event time.
+    uint32_t latencyCount;
+    uint32_t latencyMax;
+    uint64_t latencyTotal;
+
+    uint32_t durationHistogram[TRACE_HISTOGRAM_BUCKETS];
+    uint32_t latencyHistogram[TRACE_HISTOGRAM_BUCKETS];
+};
+
+static const char *const sourceNames[TRACE_SOURCE_COUNT] = {"rtc alarm", "timer", "step generator", "led dma", "work"};
+
+static struct traceEntry buffer[TRACE_BUFFER_LENGTH];
+
+/// @brief Number of runs recorded so far, the newest one is at (head - 1) % TRACE_BUFFER_LENGTH.
+static uint32_t head = 0;
+
+static struct traceStatistics statistics[TRACE_SOURCE_COUNT];
+
+static uint32_t histogramBucket(uint32_t us)
+{
+    uint32_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    return bucket < TRACE_HISTOGRAM_BUCKETS ? bucket : TRACE_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint16_t saturate(uint64_t us)
+{
+    return us > UINT16_MAX ? UINT16_MAX : us;
+}
+
+/// @brief Records a run of a handler. Use TRACE_ENTER and TRACE_EXIT instead of calling this directly.
+/// @param source What ran.
+/// @param enteredAt Time (time_us_64) at which the handler was entered.
+/// @param expectedAt Time (time_us_64) at which the handler should have run or TRACE_UNKNOWN_TIME.
+void traceRecord(enum traceSource source, uint64_t enteredAt, uint64_t expectedAt)
+{
+    uint64_t now = time_us_64();
+    uint32_t duration = saturate(now - enteredAt);
+    bool latencyKnown = expectedAt != TRACE_UNKNOWN_TIME;
+    uint32_t latency = latencyKnown && enteredAt > expectedAt ? saturate(enteredAt - expectedAt) : 0;
+
+    uint32_t status = save_and_disable_interrupts();
+
+    struct traceEntry *entry = &buffer[head++ % TRACE_BUFFER_LENGTH];
+    entry->enteredAt = enteredAt;
+    entry->duration = duration;
+    entry->latency = latency;
+    entry->source = source;
+
+    struct traceStatistics *stats = &statistics[source];
+    if (stats->count == 0 || duration < stats->durationMin)
+        stats->durationMin = duration;
+    if (duration > stats->durationMax)
+        stats->durationMax = duration;
+    stats->durationTotal += duration;
+    stats->durationHistogram[histogramBucket(duration)]++;
+    stats->count++;
+
+    if (latencyKnown)
+    {
+        if (latency > stats->latencyMax)
+            stats->latencyMax = latency;
+        stats->latencyTotal += latency;
+        stats->latencyHistogram[histogramBucket(latency)]++;
+        stats->latencyCount++;
+    }
+
+    restore_interrupts(status);
+}
+
+static void printHistogram(const char *name, const uint32_t *histogram)
+{
+    printf("  %-10s", name);
+    for (uint32_t i = 0; i < TRACE_HISTOGRAM_BUCKETS; i++)
+        printf(" %7lu", (unsigned long)histogram[i]);
+    printf("\n");
+}
+
+/// @brief Prints the statistics of every source and the most recent runs to stdout (the usb console).
+void traceDump()
+{
+    // Work on a copy so the handlers can keep recording while printing
+    static struct traceStatistics copy[TRACE_SOURCE_COUNT];
+    static struct traceEntry recent[16];
+
+    uint32_t status = save_and_disable_interrupts();
+    for (uint32_t i = 0; i < TRACE_SOURCE_COUNT; i++)
+        copy[i] = statistics[i];
+    uint32_t recentCount = head < count_of(recent) ? head : count_of(recent);
+    for (uint32_t i = 0; i < recentCount; i++)
+        recent[i] = buffer[(head - recentCount + i) % TRACE_BUFFER_LENGTH];
+    restore_interrupts(status);
+
+    printf("%-15s %10s %23s %17s\n", "source", "count", "duration us min/avg/max", "latency us avg/max");
+    for (uint32_t i = 0; i < TRACE_SOURCE_COUNT; i++)
+    {
+        struct traceStatistics *stats = &copy[i];
+        if (stats->count == 0)
+            continue;
+
+        printf("%-15s %10lu %7lu/%7.1f/%7lu", sourceNames[i], (unsigned long)stats->count,
+               (unsigned long)stats->durationMin, (double)stats->durationTotal / stats->count, (unsigned long)stats->durationMax);
+        if (stats->latencyCount > 0)
+            printf(" %8.1f/%8lu", (double)stats->latencyTotal / stats->latencyCount, (unsigned long)stats->latencyMax);
+        printf("\n");
+    }
+
+    printf("\n%-12s %7s %7s %7s %7s %7s %7s %7s %7s %7s %7s\n", "us", "0", "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128-255", ">=256");
+    for (uint32_t i = 0; i < TRACE_SOURCE_COUNT; i++)
+    {
+        if (copy[i].count == 0)
+            continue;
+
+        printf("%s\n", sourceNames[i]);
+        printHistogram("duration", copy[i].durationHistogram);
+        if (copy[i].latencyCount > 0)
+            printHistogram("latency", copy[i].latencyHistogram);
+    }
+
+    printf("\nMost recent runs (entry us, duration us, latency us):\n");
+    for (uint32_t i = 0; i < recentCount; i++)
+        printf("%10lu %6u %6u %s\n", (unsigned long)recent[i].enteredAt, recent[i].duration, recent[i].latency, sourceNames[recent[i].source]);
+}
+
+/// @brief Clears the statistics and the recent runs.
+void traceReset()
+{
+    uint32_t status = save_and_disable_interrupts();
+    head = 0;
+    for (uint32_t i = 0; i < TRACE_SOURCE_COUNT; i++)
+        statistics[i] = (struct traceStatistics){0};
+    restore_interrupts(status);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "pico/types.h"
+
+/// @brief Records when the interrupt handlers and the deferred work run. Costs a ring buffer and a few us per handler, off by default.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+/// @brief What ran.
+enum traceSource
+{
+    /// @brief rtcAlarmHandler, the minute steps.
+    TRACE_RTC_ALARM,
+
+    /// @brief Callbacks of the scheduler (steps of a seek, hold timers, led frames), late by how long after their time they ran.
+    TRACE_TIMER,
+
+    /// @brief The step generator handing the coils back after a seek.
+    TRACE_STEP_GENERATOR,
+
+    /// @brief The dma having sent a frame to the leds.
+    TRACE_LED_DMA,
+
+    /// @brief Items of the work queue, late by how long they waited in the queue.
+    TRACE_WORK,
+
+    TRACE_SOURCE_COUNT
+};
+
+/// @brief The time of the event that caused the handler isn't known, no latency gets recorded.
+#define TRACE_UNKNOWN_TIME 0
+
+#if TRACE_ENABLED
+/// @brief Put at the start of a handler.
+/// @param expectedAt Time (time_us_64) at which the handler should have run or TRACE_UNKNOWN_TIME.
+#define TRACE_ENTER(expectedAt) uint64_t traceEnteredAt = time_us_64(), traceExpectedAt = (expectedAt)
+
+/// @brief Put at the end of a handler, in the same scope as TRACE_ENTER.
+#define TRACE_EXIT(source) traceRecord((source), traceEnteredAt, traceExpectedAt)
+#else
+#define TRACE_ENTER(expectedAt)
+#define TRACE_EXIT(source)
+#endif
+
+void traceRecord(enum traceSource source, uint64_t enteredAt, uint64_t expectedAt);
+void traceDump();
+void traceReset();
+
+#endif
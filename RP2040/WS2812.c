@@ -6,26 +6,92 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/pio.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
 #include "stdlib.h"
 
 #include "WS2812.pio.h"
-#include "PWM.h"
+#include "EventLog.h"
+#include "Power.h"
+#include "Scheduler.h"
+#include "Trace.h"
+#include "WS2812.h"
 
 const bool IS_RGBW = false;
-const uint32_t NUM_PIXELS = 12;
+#define NUM_PIXELS 12
 const uint32_t WS2812_PIN = 14;
+const uint32_t WS2812_FREQUENCY = 800000;
 
 const PIO pio = pio0;
 const int sm = 0;
 
+/// @brief Front and back buffer in the format expected by the PIO program, one word per pixel.
+/// The DMA reads from the front buffer while the next frame gets rendered into the back buffer.
+static uint32_t framebuffers[2][NUM_PIXELS];
+
+/// @brief Number of pixels the pattern has written into each framebuffer.
+static uint32_t framebufferLengths[2];
+
+/// @brief Index of the framebuffer that is shown or being shown.
+static volatile uint32_t frontBuffer = 0;
+
+/// @brief Set by the renderer once the back buffer holds the next frame, cleared by the irq handler when it swaps the buffers.
+static volatile bool backBufferReady = false;
+
+/// @brief DMA channel that streams the front buffer into the TX FIFO of the state machine.
+static int dmaChannel;
+
+/// @brief Set while the DMA channel is still reading from the front buffer.
+static volatile bool transferActive = false;
+
+/// @brief Brightness all patterns get scaled by (0 to 255). Only used on core 1.
+static uint8_t brightness = 255;
+
 static inline void put_pixel(uint8_t r, uint8_t g, uint8_t b)
 {
+    r = (r * brightness) / 255;
+    g = (g * brightness) / 255;
+    b = (b * brightness) / 255;
+
     uint32_t value = ((uint32_t)(r) << 16) |
                      ((uint32_t)(g) << 24) |
                      ((uint32_t)(b) << 8);
 
-    pio_sm_put_blocking(pio, sm, value);
+    uint32_t backBuffer = frontBuffer ^ 1;
+    if (framebufferLengths[backBuffer] < NUM_PIXELS)
+        framebuffers[backBuffer][framebufferLengths[backBuffer]++] = value;
+}
+
+/// @brief Handles the DMA channel having pushed the whole front buffer into the TX FIFO.
+static void ws2812DmaIrqHandler()
+{
+    TRACE_ENTER(TRACE_UNKNOWN_TIME);
+
+    dma_channel_acknowledge_irq0(dmaChannel);
+    transferActive = false;
+
+    TRACE_EXIT(TRACE_LED_DMA);
+}
+
+/// @brief Makes the back buffer the front buffer and starts streaming it to the leds.
+/// Returns immediately, the end of the transfer is signaled by the DMA irq.
+static void ws2812_swap_buffers()
+{
+    frontBuffer ^= 1;
+    backBufferReady = false;
+
+    // Patterns that only update every few frames don't write any pixels in between
+    uint32_t length = framebufferLengths[frontBuffer];
+    if (length == 0)
+        return;
+
+    transferActive = true;
+    dma_channel_transfer_from_buffer_now(dmaChannel, framebuffers[frontBuffer], length);
 }
 
 void pattern_snakes(uint len, uint t)
@@ -160,15 +226,71 @@ const struct
     {1020, pattern_rgbfade},
 };
 
-/// @brief Initializes the PIO for driving the WS2812 leds.
-void ws2812_init()
+/// @brief Commands core 0 sends to the animation engine on core 1.
+enum ws2812CommandType
 {
-    uint offset = pio_add_program(pio, &ws2812_program);
-    ws2812_program_init(pio, sm, offset, WS2812_PIN, 800000, IS_RGBW);
+    WS2812_COMMAND_START,
+    WS2812_COMMAND_STOP,
+    WS2812_COMMAND_BRIGHTNESS,
+};
+
+struct ws2812Command
+{
+    uint8_t type;
+    uint8_t argument;
+};
+
+/// @brief Length of the command queue, needs to be a power of two.
+#define COMMAND_QUEUE_LENGTH 8
+
+/// @brief Single producer (core 0) single consumer (core 1) ring of commands.
+/// The head is only written by core 0 and the tail only by core 1 so no locking is needed.
+static struct ws2812Command commandQueue[COMMAND_QUEUE_LENGTH];
+static volatile uint32_t commandQueueHead = 0;
+static volatile uint32_t commandQueueTail = 0;
+
+/// @brief Puts a command into the queue and wakes up core 1. Called from core 0 only.
+/// @return false when the queue is full.
+static bool ws2812_post_command(enum ws2812CommandType type, uint8_t argument)
+{
+    uint32_t head = commandQueueHead;
+    if (head - commandQueueTail == COMMAND_QUEUE_LENGTH)
+        return false;
+
+    commandQueue[head % COMMAND_QUEUE_LENGTH].type = type;
+    commandQueue[head % COMMAND_QUEUE_LENGTH].argument = argument;
+
+    // The command has to be visible to core 1 before the new head
+    __dmb();
+    commandQueueHead = head + 1;
+    __sev();
+
+    return true;
 }
 
-/// @brief Indicates whether a pattern is currently active or not.
-bool animationActive = false;
+/// @brief Takes the next command from the queue. Called from core 1 only.
+/// @return false when the queue is empty.
+static bool ws2812_take_command(struct ws2812Command *command)
+{
+    uint32_t tail = commandQueueTail;
+    if (tail == commandQueueHead)
+        return false;
+
+    __dmb();
+    *command = commandQueue[tail % COMMAND_QUEUE_LENGTH];
+    commandQueueTail = tail + 1;
+
+    return true;
+}
+
+/// @brief Indicates whether a pattern is currently active or not. Owned by core 0.
+volatile bool animationActive = false;
+
+/// @brief Indicates whether core 1 is rendering a pattern.
+bool patternRunning = false;
+
+/// @brief Set once the renderer has put the final (all off) frame of the pattern into the back buffer.
+volatile bool lastFrameRendered = false;
 
 /// @brief Counter that keeps track of the time the pattern has been running for.
 uint32_t time = 0;
@@ -176,39 +298,198 @@ uint32_t time = 0;
 /// @brief The currently selected pattern-
 uint32_t selectedPattern = 0;
 
-/// @brief Handles the timer interrupt and updates the WS2812 leds with the next "frame" of the pattern.
-void ws2812_update_pattern()
+/// @brief Time between two frames of a pattern in us (50 frames per second).
+const uint32_t frameInterval = 20000;
+
+/// @brief Lets the clocks of the leds go once the final frame of a pattern has been shifted out.
+static void ws2812_power_down(struct schedulerEvent *event)
 {
+    powerRelease(POWER_STATE_ANIMATING);
+}
+
+/// @brief Timer event a frame after the final frame of a pattern.
+static struct schedulerEvent powerDownEvent = SCHEDULER_EVENT_INIT(ws2812_power_down);
+
+/// @brief Handles the frame timer event and shows the frame that core 1 rendered in the meantime.
+void ws2812_update_pattern(struct schedulerEvent *event)
+{
+    // Either the renderer didn't get to run since the last frame or the previous frame is still
+    // being read from the front buffer. In both cases show the next frame on the next tick.
+    if (!backBufferReady || transferActive)
+    {
+        schedulerAdd(event, event->time + frameInterval);
+        return;
+    }
+
+    ws2812_swap_buffers();
+
+    if (lastFrameRendered)
+    {
+        animationActive = false;
+
+        // The dma and the pio are still busy with the final frame
+        schedulerAdd(&powerDownEvent, event->time + frameInterval);
+        return;
+    }
+
+    // Let core 1 render the next frame into the buffer that just got free
+    __sev();
+
+    schedulerAdd(event, event->time + frameInterval);
+}
+
+/// @brief Timer event for the frames of the active pattern.
+struct schedulerEvent frameEvent = SCHEDULER_EVENT_INIT(ws2812_update_pattern);
+
+/// @brief Renders the next frame of the running pattern into the back buffer. Runs on core 1.
+/// @return true when a frame was rendered.
+static bool ws2812_render_frame()
+{
+    if (!patternRunning || backBufferReady || lastFrameRendered)
+        return false;
+
+    uint32_t backBuffer = frontBuffer ^ 1;
+    framebufferLengths[backBuffer] = 0;
+
     uint32_t duration = pattern_table[selectedPattern].duration;
 
     if (time >= duration)
     {
-        deconfigurePwmFrom50hzTimer(&ws2812_update_pattern);
-
         for (int i = 0; i < NUM_PIXELS; ++i)
             put_pixel(0, 0, 0);
 
-        animationActive = false;
+        lastFrameRendered = true;
+        patternRunning = false;
+    }
+    else
+    {
+        pattern_table[selectedPattern].pat(NUM_PIXELS, time);
+        time++;
+    }
 
-        return;
+    // Hand the buffer over to the irq handler only once it is completely written
+    __dmb();
+    backBufferReady = true;
+
+    return true;
+}
+
+/// @brief Handles a command from core 0. Runs on core 1.
+static void ws2812_handle_command(const struct ws2812Command *command)
+{
+    switch (command->type)
+    {
+    case WS2812_COMMAND_START:
+        time = 0;
+        lastFrameRendered = false;
+        backBufferReady = false;
+        selectedPattern = command->argument < count_of(pattern_table) ? command->argument : rand() % count_of(pattern_table);
+        patternRunning = true;
+        break;
+
+    case WS2812_COMMAND_STOP:
+        // Jump to the end so the next frame is the final (all off) one
+        if (patternRunning)
+            time = pattern_table[selectedPattern].duration;
+        break;
+
+    case WS2812_COMMAND_BRIGHTNESS:
+        brightness = command->argument;
+        break;
     }
+}
+
+/// @brief Main loop of core 1. Handles the commands from core 0 and renders the frames of the running pattern.
+static void ws2812_core1_entry()
+{
+    // Core 0 stops this core while it writes the flash
+    multicore_lockout_victim_init();
 
-    pattern_table[selectedPattern].pat(NUM_PIXELS, time);
+    // The scr is private to each core, the clocks only get gated while both sleep with SLEEPDEEP set
+    scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
 
-    time++;
+    while (true)
+    {
+        struct ws2812Command command;
+        while (ws2812_take_command(&command))
+            ws2812_handle_command(&command);
 
-    clear50hzTimerIrq();
+        // Sleep until core 0 posts a command or the timer interrupt took the back buffer
+        if (!ws2812_render_frame())
+            __wfe();
+    }
 }
 
-/// @brief Starts a random pattern
-void ws2812_do_pattern()
+/// @brief Keeps the bit timing of the leds when clk_sys changes.
+static void ws2812_clock_changed(struct powerClockListener *listener, uint32_t sysHz)
+{
+    int cycles_per_bit = ws2812_T1 + ws2812_T2 + ws2812_T3;
+    pio_sm_set_clkdiv(pio, sm, (float)sysHz / (WS2812_FREQUENCY * cycles_per_bit));
+}
+
+static struct powerClockListener clockListener = POWER_CLOCK_LISTENER_INIT(ws2812_clock_changed);
+
+/// @brief Initializes the PIO for driving the WS2812 leds and starts the animation engine on core 1.
+void ws2812_init()
+{
+    uint offset = pio_add_program(pio, &ws2812_program);
+    ws2812_program_init(pio, sm, offset, WS2812_PIN, WS2812_FREQUENCY, IS_RGBW);
+    powerAddClockListener(&clockListener);
+
+    // One word per pixel is paced by the TX FIFO of the state machine
+    dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config dmaConfig = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&dmaConfig, DMA_SIZE_32);
+    channel_config_set_read_increment(&dmaConfig, true);
+    channel_config_set_write_increment(&dmaConfig, false);
+    channel_config_set_dreq(&dmaConfig, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(dmaChannel, &dmaConfig, &pio->txf[sm], framebuffers[0], NUM_PIXELS, false);
+
+    dma_channel_set_irq0_enabled(dmaChannel, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, ws2812DmaIrqHandler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    multicore_launch_core1(ws2812_core1_entry);
+}
+
+/// @brief Starts the given pattern. Called from core 0.
+/// @param pattern Index into the pattern table or WS2812_RANDOM_PATTERN.
+void ws2812_start_pattern(uint8_t pattern)
 {
     if (animationActive)
         return;
 
+    if (!ws2812_post_command(WS2812_COMMAND_START, pattern))
+        return;
+
     animationActive = true;
-    time = 0;
-    selectedPattern = rand() % count_of(pattern_table);
+    eventLogWrite(EVENT_PATTERN, pattern, 0);
+    powerRequest(POWER_STATE_ANIMATING);
+    schedulerAdd(&frameEvent, time_us_64() + frameInterval);
+}
 
-    configurePwmAs50hzTimer(&ws2812_update_pattern);
+/// @brief Returns the number of patterns in the pattern table.
+uint8_t ws2812_get_pattern_count()
+{
+    return count_of(pattern_table);
+}
+
+/// @brief Starts a random pattern
+void ws2812_do_pattern()
+{
+    ws2812_start_pattern(WS2812_RANDOM_PATTERN);
+}
+
+/// @brief Ends the active pattern early with all leds off.
+void ws2812_stop_pattern()
+{
+    if (animationActive)
+        ws2812_post_command(WS2812_COMMAND_STOP, 0);
+}
+
+/// @brief Sets the brightness all patterns get scaled by.
+/// @param value 0 (off) to 255 (full brightness).
+void ws2812_set_brightness(uint8_t value)
+{
+    ws2812_post_command(WS2812_COMMAND_BRIGHTNESS, value);
 }
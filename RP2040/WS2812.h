@@ -1,7 +1,16 @@
 #ifndef WS2812_H
 #define WS2812_H
 
+#include "pico/types.h"
+
+/// @brief Pattern index that lets the animation engine pick a random pattern.
+#define WS2812_RANDOM_PATTERN 0xff
+
 void ws2812_init();
 void ws2812_do_pattern();
+void ws2812_start_pattern(uint8_t pattern);
+void ws2812_stop_pattern();
+void ws2812_set_brightness(uint8_t value);
+uint8_t ws2812_get_pattern_count();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+#include "pico/stdlib.h"
+
+#include "RTC.h"
+#include "Seek.h"
+#include "WarmStart.h"
+
+// Keeps everything the clock needs to carry on after a watchdog or soft reset in the scratch registers of the watchdog.
+// Those only get cleared by a power on or the RUN pin, so after a reset the clock skips the setup and goes on
+// with the time and the hand positions of the last minute step. Scratch 4 to 7 belong to the sdk and the boot rom.
+//
+// The rtc stops with the reset. Every time the watchdog gets fed the time since the save is stored as well, so the
+// time that got lost is known: from the save to the last feed, the watchdog timeout and the boot up to rtcInit.
+//
+// scratch[0]: magic (16 bits) and checksum of scratch 1 to 3 (16 bits)
+// scratch[1]: year (12 bits), month (4), day (5), day of the week (3), hour (5)
+// scratch[2]: minute (6), second (6), time set (1, see rtcInit), tenths of a second from the save to the last feed (19)
+// scratch[3]: positions of the hands and phases of the motors (seekGetHandState)
+
+#define WARM_START_MAGIC 0x5753 // "WS"
+
+/// @brief Bits of scratch[2] that hold the time from the save to the last feed, it stops at the largest value (14.5h).
+#define WARM_START_ALIVE_SHIFT 13
+#define WARM_START_ALIVE_MAX ((1u << 19) - 1)
+#define WARM_START_ALIVE_UNIT_US 100000
+
+/// @brief Timer (time_us_64) of the last save.
+static uint64_t savedAt = 0;
+
+static uint32_t checksum(uint32_t date, uint32_t time, uint32_t hands)
+{
+    uint32_t sum = date ^ ((time << 11) | (time >> 21)) ^ ((hands << 22) | (hands >> 10));
+    return (sum ^ (sum >> 16)) & 0xffff;
+}
+
+/// @brief Picks up the state a previous run left in the scratch registers and sets up the steppers with it.
+/// Needs to be called before the steppers get initialized, so their coils get energized where the rotors are.
+/// @param dateTime Set to the time of the rtc at the last save (UTC once the time is set, see rtcStart).
+/// @param timeSet Set to false when the time came from the hands at power up and isn't fully known.
+/// @param lostUs Set to the time from the save to the reset, the time since boot needs to be added to that.
+/// @return false after a power on or when the previous run didn't leave a valid state, the clock needs to be set up then.
+bool warmStartRestore(datetime_t *dateTime, bool *timeSet, uint64_t *lostUs)
+{
+    uint32_t date = watchdog_hw->scratch[1];
+    uint32_t time = watchdog_hw->scratch[2];
+    uint32_t hands = watchdog_hw->scratch[3];
+
+    if (watchdog_hw->scratch[0] != ((WARM_START_MAGIC << 16) | checksum(date, time, hands)))
+        return false;
+
+    dateTime->year = date & 0xfff;
+    dateTime->month = (date >> 12) & 0xf;
+    dateTime->day = (date >> 16) & 0x1f;
+    dateTime->dotw = (date >> 21) & 0x7;
+    dateTime->hour = (date >> 24) & 0x1f;
+    dateTime->min = time & 0x3f;
+    dateTime->sec = (time >> 6) & 0x3f;
+
+    if (dateTime->month < 1 || dateTime->month > 12 || dateTime->day < 1 || dateTime->hour > 23 ||
+        dateTime->min > 59 || dateTime->sec > 59)
+        return false;
+
+    if (!seekRestoreHandState(hands))
+        return false;
+
+    *timeSet = (time >> 12) & 0x1;
+
+    // After the last feed the firmware was stuck until the watchdog reset the chip
+    *lostUs = (uint64_t)(time >> WARM_START_ALIVE_SHIFT) * WARM_START_ALIVE_UNIT_US + WARM_START_WATCHDOG_TIMEOUT * 1000ull;
+
+    return true;
+}
+
+/// @brief Stores the time and the hand positions for the next reset.
+/// Only a few register writes, called from the rtc alarm after every minute step.
+/// @param dateTime The time of the rtc.
+void warmStartSave(datetime_t *dateTime)
+{
+    uint32_t date = (dateTime->year & 0xfff) |
+                    ((dateTime->month & 0xf) << 12) |
+                    ((dateTime->day & 0x1f) << 16) |
+                    ((dateTime->dotw & 0x7) << 21) |
+                    ((dateTime->hour & 0x1f) << 24);
+
+    uint32_t time = (dateTime->min & 0x3f) |
+                    ((dateTime->sec & 0x3f) << 6) |
+                    (rtcIsTimeSet() << 12);
+
+    uint32_t hands = seekGetHandState();
+
+    // A reset between the writes leaves a checksum that doesn't match, which is the same as no state at all
+    savedAt = time_us_64();
+    watchdog_hw->scratch[1] = date;
+    watchdog_hw->scratch[2] = time;
+    watchdog_hw->scratch[3] = hands;
+    watchdog_hw->scratch[0] = (WARM_START_MAGIC << 16) | checksum(date, time, hands);
+}
+
+/// @brief Feeds the watchdog and stores how long after the save that was, in place of watchdog_update.
+void warmStartFeed()
+{
+    watchdog_update();
+
+    uint32_t status = save_and_disable_interrupts();
+
+    if ((watchdog_hw->scratch[0] >> 16) == WARM_START_MAGIC)
+    {
+        uint32_t date = watchdog_hw->scratch[1];
+        uint32_t hands = watchdog_hw->scratch[3];
+        uint32_t alive = MIN((time_us_64() - savedAt) / WARM_START_ALIVE_UNIT_US, WARM_START_ALIVE_MAX);
+        uint32_t time = (watchdog_hw->scratch[2] & ((1u << WARM_START_ALIVE_SHIFT) - 1)) | (alive << WARM_START_ALIVE_SHIFT);
+
+        watchdog_hw->scratch[2] = time;
+        watchdog_hw->scratch[0] = (WARM_START_MAGIC << 16) | checksum(date, time, hands);
+    }
+
+    restore_interrupts(status);
+}
+
+/// @brief Throws away the stored state. For when the hands get moved in a way that doesn't end in a save (homing).
+void warmStartInvalidate()
+{
+    watchdog_hw->scratch[0] = 0;
+}
+
+/// @brief Starts the watchdog. From here on the firmware has to feed it within WARM_START_WATCHDOG_TIMEOUT
+/// whenever it runs, if it gets stuck the chip resets and warmStartRestore picks up from the last save.
+void warmStartArm()
+{
+    watchdog_enable(WARM_START_WATCHDOG_TIMEOUT, true);
+}
+
+/// @brief Waits for an interrupt with the watchdog stopped, the core sleeps for up to a minute between two alarms.
+/// Needs to be called with interrupts disabled so the watchdog runs again before any handler does.
+void warmStartWaitForInterrupt()
+{
+    uint32_t enabled = watchdog_hw->ctrl & WATCHDOG_CTRL_ENABLE_BITS;
+
+    hw_clear_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+    __wfi();
+
+    if (enabled)
+    {
+        warmStartFeed();
+        hw_set_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include "pico/types.h"
+
+/// @brief Time in ms the firmware has to feed the watchdog in while it runs, the longest the watchdog can do is 8388ms.
+#define WARM_START_WATCHDOG_TIMEOUT 8000
+
+bool warmStartRestore(datetime_t *dateTime, bool *timeSet, uint64_t *lostUs);
+void warmStartSave(datetime_t *dateTime);
+void warmStartInvalidate();
+void warmStartArm();
+void warmStartFeed();
+void warmStartWaitForInterrupt();
+
+#endif
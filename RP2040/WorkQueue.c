@@ -0,0 +1,86 @@
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include "Trace.h"
+#include "WorkQueue.h"
+
+// Bottom half of the interrupt handlers. Handlers only do what has to happen at that exact moment (output a step,
+// swap a frame) and post the rest here. Every loop that sleeps on core 0 drains the queue before its wfi.
+
+/// @brief First and last item of the queue, items run in the order they were posted.
+static struct workItem *head = NULL;
+static struct workItem *tail = NULL;
+
+/// @brief Longest time an item waited in the queue in us.
+static uint64_t maxDelay = 0;
+
+/// @brief Queues an item. Posting an item that is still queued does nothing, it only runs once.
+/// Can be called from interrupt handlers.
+/// @param item The item to queue.
+void workQueuePost(struct workItem *item)
+{
+    uint32_t status = save_and_disable_interrupts();
+
+    if (!item->queued)
+    {
+        item->postedAt = time_us_64();
+        item->next = NULL;
+        item->queued = true;
+
+        if (tail != NULL)
+            tail->next = item;
+        else
+            head = item;
+        tail = item;
+    }
+
+    restore_interrupts(status);
+}
+
+/// @brief Runs all queued items, including the ones posted while running. Called from thread mode on core 0 only.
+/// @return true when at least one item was run.
+bool workQueueRun()
+{
+    bool ran = false;
+
+    while (true)
+    {
+        uint32_t status = save_and_disable_interrupts();
+        struct workItem *item = head;
+        if (item != NULL)
+        {
+            head = item->next;
+            if (head == NULL)
+                tail = NULL;
+            item->queued = false;
+        }
+        restore_interrupts(status);
+
+        if (item == NULL)
+            break;
+
+        uint64_t delay = time_us_64() - item->postedAt;
+        if (delay > maxDelay)
+            maxDelay = delay;
+
+        TRACE_ENTER(item->postedAt);
+        item->callback(item);
+        TRACE_EXIT(TRACE_WORK);
+        ran = true;
+    }
+
+    return ran;
+}
+
+/// @brief Indicates whether nothing is queued. Call with interrupts disabled right before a wfi,
+/// an item posted after that wakes the core again.
+bool workQueueIsEmpty()
+{
+    return head == NULL;
+}
+
+/// @brief Returns the longest time an item waited in the queue before it ran in us.
+uint64_t workQueueGetMaxDelay()
+{
+    return maxDelay;
+}
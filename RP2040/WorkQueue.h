@@ -0,0 +1,35 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include "pico/types.h"
+
+struct workItem;
+
+/// @brief Called from thread mode on core 0 when the queue gets drained.
+/// The item is no longer queued at that point and can be posted again from inside the callback.
+typedef void (*workCallback)(struct workItem *item);
+
+/// @brief Work an interrupt handler hands over to thread mode. Owned by the caller and kept in the queue while it is queued.
+struct workItem
+{
+    /// @brief The function to call.
+    workCallback callback;
+
+    /// @brief Time (time_us_64) at which the item was posted.
+    uint64_t postedAt;
+
+    /// @brief Next item in the queue. Leave at NULL.
+    struct workItem *next;
+
+    /// @brief Set while the item is in the queue. Leave at false.
+    bool queued;
+};
+
+#define WORK_ITEM_INIT(callback) {(callback), 0, NULL, false}
+
+void workQueuePost(struct workItem *item);
+bool workQueueRun();
+bool workQueueIsEmpty();
+uint64_t workQueueGetMaxDelay();
+
+#endif